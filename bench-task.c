@@ -0,0 +1,69 @@
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Synthetic workload for the bench driver.
+ *
+ * The scheduler exec()s its tasks without arguments, so the kind of
+ * work is taken from the name we were started as, "<mode>-<ms>":
+ *
+ *   cpu-<ms>   : spin until <ms> of CPU time has been used
+ *   short-<ms> : same, meant for a few milliseconds
+ *   io-<n>     : <n> rounds of a 1ms CPU burst followed by a 5ms sleep
+ *
+ * CPU time rather than wall time is counted, so the amount of work is
+ * the same no matter how often the scheduler stops us.
+ */
+
+#define IO_BURST_MS 1
+#define IO_SLEEP_MS 5
+
+static long long cputime_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void spin(long msec)
+{
+	long long until = cputime_ns() + msec * 1000000LL;
+	volatile long junk = 0;
+
+	while (cputime_ns() < until)
+		junk++;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec nap = { 0, IO_SLEEP_MS * 1000000L };
+	char *name, *dash;
+	long n;
+
+	name = strrchr(argv[0], '/');
+	name = (name != NULL) ? name + 1 : argv[0];
+	dash = strrchr(name, '-');
+	if (dash == NULL || (n = atol(dash + 1)) <= 0) {
+		fprintf(stderr, "%s: expected to be started as <mode>-<n>\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (!strncmp(name, "cpu-", 4) || !strncmp(name, "short-", 6)) {
+		spin(n);
+	} else if (!strncmp(name, "io-", 3)) {
+		while (n-- > 0) {
+			spin(IO_BURST_MS);
+			nanosleep(&nap, NULL);
+		}
+	} else {
+		fprintf(stderr, "%s: unknown mode\n", argv[0]);
+		return 1;
+	}
+
+	return 0;
+}
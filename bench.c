@@ -0,0 +1,441 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+
+/*
+ * Scheduler benchmark driver.
+ *
+ * Runs a mix of CPU-bound, I/O-bound and short-lived bench-task workers
+ * under scheduler (or scheduler-shell) for every policy and quantum
+ * asked for, reads back the -s statistics dump and appends one CSV row
+ * per run: makespan, throughput, mean and p99 turnaround and context
+ * switches per second.
+ */
+
+#define BENCH_MAX_LIST 16
+
+struct bench_config {
+	char *sched;
+	char *policies[BENCH_MAX_LIST];
+	int npolicies;
+	long quanta[BENCH_MAX_LIST];
+	int nquanta;
+	int ncpus;
+	int ncpu, nio, nshort;
+	long cpu_ms, io_rounds, short_ms;
+	int runs;
+	char *csv;
+};
+
+struct bench_result {
+	double makespan_s;
+	double throughput;
+	double turnaround_mean_ms;
+	double turnaround_p99_ms;
+	long dispatches;
+	double switches_per_s;
+	int ntasks;
+};
+
+static char tmpdir[] = "/tmp/sched-bench.XXXXXX";
+static char bindir[PATH_MAX - 32];
+static int verbose = 0;
+
+static void usage(char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-x scheduler] [-p policy[,policy...]] [-q ms[,ms...]] [-c ncpus]\n"
+		"       [-C n_cpu] [-I n_io] [-S n_short] [-L cpu_ms] [-R io_rounds] [-T short_ms]\n"
+		"       [-r runs] [-o file.csv] [-v]\n", argv0);
+	exit(1);
+}
+
+/* Split a comma-separated option argument, in place */
+static int split_list(char *arg, char **out)
+{
+	int n = 0;
+	char *tok;
+
+	for (tok = strtok(arg, ","); tok != NULL; tok = strtok(NULL, ",")) {
+		if (n == BENCH_MAX_LIST) {
+			fprintf(stderr, "Too many list entries, max %d\n",
+				BENCH_MAX_LIST);
+			exit(1);
+		}
+		out[n++] = tok;
+	}
+	return n;
+}
+
+static char *in_bindir(const char *name)
+{
+	static char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/%s", bindir, name);
+	return path;
+}
+
+/*
+ * bench-task picks its workload from its own name, so give it one
+ * symlink per kind of task in a scratch directory.
+ */
+static void make_links(struct bench_config *cfg)
+{
+	char target[PATH_MAX], link[PATH_MAX];
+	char *name[3];
+	int i;
+
+	if (mkdtemp(tmpdir) == NULL) {
+		perror("mkdtemp");
+		exit(1);
+	}
+	snprintf(target, sizeof(target), "%s", in_bindir("bench-task"));
+	if (access(target, X_OK) < 0) {
+		perror(target);
+		exit(1);
+	}
+
+	asprintf(&name[0], "cpu-%ld", cfg->cpu_ms);
+	asprintf(&name[1], "io-%ld", cfg->io_rounds);
+	asprintf(&name[2], "short-%ld", cfg->short_ms);
+	for (i = 0; i < 3; i++) {
+		snprintf(link, sizeof(link), "%s/%s", tmpdir, name[i]);
+		if (symlink(target, link) < 0) {
+			perror("symlink");
+			exit(1);
+		}
+		free(name[i]);
+	}
+}
+
+static void remove_links(struct bench_config *cfg)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/cpu-%ld", tmpdir, cfg->cpu_ms);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/io-%ld", tmpdir, cfg->io_rounds);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/short-%ld", tmpdir, cfg->short_ms);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/stats", tmpdir);
+	unlink(path);
+	rmdir(tmpdir);
+}
+
+/*
+ * Interleave the three kinds of task on the command line, so that no
+ * kind gets to start first just because of its position.
+ */
+static char **build_argv(struct bench_config *cfg, const char *policy,
+			 long quantum, char *stats)
+{
+	int ntasks = cfg->ncpu + cfg->nio + cfg->nshort;
+	int left[3] = { cfg->ncpu, cfg->nio, cfg->nshort };
+	long arg[3] = { cfg->cpu_ms, cfg->io_rounds, cfg->short_ms };
+	const char *kind[3] = { "cpu", "io", "short" };
+	char **argv = calloc(ntasks + 12, sizeof(*argv));
+	int n = 0, k;
+
+	if (argv == NULL) {
+		perror("calloc");
+		exit(1);
+	}
+	argv[n++] = cfg->sched;
+	argv[n++] = "-p";
+	argv[n++] = (char *)policy;
+	argv[n++] = "-q";
+	asprintf(&argv[n++], "%ld", quantum);
+	argv[n++] = "-c";
+	asprintf(&argv[n++], "%d", cfg->ncpus);
+	argv[n++] = "-s";
+	argv[n++] = stats;
+	/* Every task's turnaround is needed, not just the latest */
+	argv[n++] = "-S";
+	asprintf(&argv[n++], "%d", ntasks);
+	while (left[0] + left[1] + left[2] > 0) {
+		for (k = 0; k < 3; k++) {
+			if (left[k] == 0)
+				continue;
+			asprintf(&argv[n++], "%s/%s-%ld", tmpdir, kind[k], arg[k]);
+			left[k]--;
+		}
+	}
+	argv[n] = NULL;
+	return argv;
+}
+
+static void free_argv(char **argv)
+{
+	int i;
+
+	/* Everything past the fixed options was allocated by asprintf() */
+	free(argv[4]);
+	free(argv[6]);
+	for (i = 10; argv[i] != NULL; i++)
+		free(argv[i]);
+	free(argv);
+}
+
+static int run_scheduler(char **argv)
+{
+	int status, fd;
+	pid_t pid;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (pid == 0) {
+		/* scheduler-shell's shell quits on EOF, leaving the tasks alone */
+		fd = open("/dev/null", O_RDWR);
+		dup2(fd, 0);
+		dup2(fd, 1);
+		if (!verbose)
+			dup2(fd, 2);
+		execv(argv[0], argv);
+		perror(argv[0]);
+		_exit(127);
+	}
+	if (waitpid(pid, &status, 0) < 0) {
+		perror("waitpid");
+		exit(1);
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "bench: %s did not exit cleanly (status %#x)\n",
+			argv[0], status);
+		return -1;
+	}
+	return 0;
+}
+
+static long long key_ll(const char *line, const char *key)
+{
+	const char *p = strstr(line, key);
+
+	return (p != NULL) ? atoll(p + strlen(key)) : 0;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Read the scheduler's statistics dump. Only our own workers count, so
+ * the shell task of scheduler-shell doesn't skew the numbers.
+ */
+static int parse_stats(const char *path, int ntasks, struct bench_result *res)
+{
+	long long *turnaround, first = -1, last = 0, created, exited, sum = 0;
+	char line[1024], *name;
+	FILE *fp;
+	int n = 0;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		perror(path);
+		return -1;
+	}
+	if ((turnaround = calloc(ntasks, sizeof(*turnaround))) == NULL) {
+		perror("calloc");
+		exit(1);
+	}
+
+	memset(res, 0, sizeof(*res));
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		if (!strncmp(line, "sched ", 6)) {
+			res->dispatches = key_ll(line, " dispatches=");
+			continue;
+		}
+		if (strncmp(line, "task ", 5) != 0)
+			continue;
+		name = strstr(line, " name=");
+		if (name == NULL || strncmp(name + 6, tmpdir, strlen(tmpdir)) != 0)
+			continue;
+		if (strstr(line, " state=exited ") == NULL || n == ntasks)
+			continue;
+
+		created = key_ll(line, " created_ns=");
+		exited = key_ll(line, " exited_ns=");
+		if (first < 0 || created < first)
+			first = created;
+		if (exited > last)
+			last = exited;
+		turnaround[n++] = exited - created;
+		sum += exited - created;
+	}
+	fclose(fp);
+
+	if (n != ntasks) {
+		fprintf(stderr, "bench: %d of %d tasks finished\n", n, ntasks);
+		free(turnaround);
+		return -1;
+	}
+
+	qsort(turnaround, n, sizeof(*turnaround), cmp_ll);
+	res->ntasks = n;
+	res->makespan_s = (last - first) / 1e9;
+	res->throughput = n / res->makespan_s;
+	res->turnaround_mean_ms = sum / 1e6 / n;
+	res->turnaround_p99_ms = turnaround[(99 * n + 99) / 100 - 1] / 1e6;
+	res->switches_per_s = res->dispatches / res->makespan_s;
+	free(turnaround);
+	return 0;
+}
+
+static FILE *open_csv(const char *path)
+{
+	struct stat st;
+	FILE *fp;
+
+	if ((fp = fopen(path, "a")) == NULL) {
+		perror(path);
+		exit(1);
+	}
+	if (fstat(fileno(fp), &st) == 0 && st.st_size == 0)
+		fprintf(fp, "scheduler,policy,quantum_ms,cpus,cpu_tasks,io_tasks,"
+			"short_tasks,run,makespan_s,throughput_tps,"
+			"turnaround_mean_ms,turnaround_p99_ms,dispatches,"
+			"switches_per_s\n");
+	return fp;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_config cfg = {
+		.ncpus = 1, .ncpu = 4, .nio = 4, .nshort = 16,
+		.cpu_ms = 200, .io_rounds = 20, .short_ms = 5,
+		.runs = 3, .csv = "bench.csv",
+	};
+	char *list[BENCH_MAX_LIST], stats[PATH_MAX], *sched_name = "scheduler";
+	struct bench_result res;
+	int opt, i, p, q, r, ntasks, failed = 0;
+	char **sargv;
+	ssize_t len;
+	FILE *csv;
+
+	len = readlink("/proc/self/exe", bindir, sizeof(bindir) - 1);
+	if (len < 0) {
+		perror("readlink");
+		exit(1);
+	}
+	bindir[len] = '\0';
+	*strrchr(bindir, '/') = '\0';
+
+	while ((opt = getopt(argc, argv, "x:p:q:c:C:I:S:L:R:T:r:o:v")) != -1) {
+		switch (opt) {
+			case 'x':
+				sched_name = optarg;
+				break;
+			case 'p':
+				cfg.npolicies = split_list(optarg, cfg.policies);
+				break;
+			case 'q':
+				cfg.nquanta = split_list(optarg, list);
+				for (i = 0; i < cfg.nquanta; i++)
+					if ((cfg.quanta[i] = atol(list[i])) <= 0)
+						usage(argv[0]);
+				break;
+			case 'c':
+				cfg.ncpus = atoi(optarg);
+				break;
+			case 'C':
+				cfg.ncpu = atoi(optarg);
+				break;
+			case 'I':
+				cfg.nio = atoi(optarg);
+				break;
+			case 'S':
+				cfg.nshort = atoi(optarg);
+				break;
+			case 'L':
+				cfg.cpu_ms = atol(optarg);
+				break;
+			case 'R':
+				cfg.io_rounds = atol(optarg);
+				break;
+			case 'T':
+				cfg.short_ms = atol(optarg);
+				break;
+			case 'r':
+				cfg.runs = atoi(optarg);
+				break;
+			case 'o':
+				cfg.csv = optarg;
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	ntasks = cfg.ncpu + cfg.nio + cfg.nshort;
+	if (optind != argc || ntasks <= 0 || cfg.ncpu < 0 || cfg.nio < 0 ||
+	    cfg.nshort < 0 || cfg.ncpus <= 0 || cfg.runs <= 0 ||
+	    cfg.cpu_ms <= 0 || cfg.io_rounds <= 0 || cfg.short_ms <= 0)
+		usage(argv[0]);
+	if (cfg.npolicies == 0)
+		cfg.policies[cfg.npolicies++] = "rr";
+	if (cfg.nquanta == 0)
+		cfg.quanta[cfg.nquanta++] = 100;
+	cfg.sched = strchr(sched_name, '/') ? sched_name
+					   : strdup(in_bindir(sched_name));
+
+	make_links(&cfg);
+	snprintf(stats, sizeof(stats), "%s/stats", tmpdir);
+	csv = open_csv(cfg.csv);
+
+	printf("%-8s %6s %4s %10s %10s %12s %12s %10s\n", "policy", "q_ms",
+	       "run", "makespan_s", "tasks/s", "turn_mean_ms", "turn_p99_ms",
+	       "switch/s");
+	for (p = 0; p < cfg.npolicies; p++) {
+		for (q = 0; q < cfg.nquanta; q++) {
+			for (r = 0; r < cfg.runs; r++) {
+				sargv = build_argv(&cfg, cfg.policies[p],
+						   cfg.quanta[q], stats);
+				unlink(stats);
+				if (run_scheduler(sargv) < 0 ||
+				    parse_stats(stats, ntasks, &res) < 0) {
+					failed++;
+					free_argv(sargv);
+					continue;
+				}
+				free_argv(sargv);
+
+				printf("%-8s %6ld %4d %10.3f %10.2f %12.1f %12.1f %10.1f\n",
+				       cfg.policies[p], cfg.quanta[q], r,
+				       res.makespan_s, res.throughput,
+				       res.turnaround_mean_ms,
+				       res.turnaround_p99_ms, res.switches_per_s);
+				fprintf(csv, "%s,%s,%ld,%d,%d,%d,%d,%d,%.6f,%.3f,"
+					"%.3f,%.3f,%ld,%.3f\n",
+					sched_name, cfg.policies[p],
+					cfg.quanta[q], cfg.ncpus, cfg.ncpu,
+					cfg.nio, cfg.nshort, r,
+					res.makespan_s, res.throughput,
+					res.turnaround_mean_ms,
+					res.turnaround_p99_ms, res.dispatches,
+					res.switches_per_s);
+				fflush(csv);
+			}
+		}
+	}
+
+	fclose(csv);
+	remove_links(&cfg);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+
+/*
+ * Completely fair: every slice goes to the task that has had the least
+ * CPU time, weighted. Each task's vruntime advances by the CPU time it
+ * actually used in its slice (read from its CPU clock by the core, so
+ * a task that blocks or exits early is charged only for what it used),
+ * scaled by CFS_WEIGHT / its weight. The tasks are kept in a red-black
+ * tree ordered by vruntime, so picking is O(1) and requeueing O(log n).
+ *
+ * Tasks are never taken off the queue when they block, so a task that
+ * uses next to no CPU would otherwise be picked every other time, each
+ * time idling the slot for a whole quantum. A slice is therefore charged
+ * at least 1/CFS_MIN_CHARGE_DIV of the base quantum: tasks that block
+ * still come first, up to that many times as often.
+ *
+ * h and l give a task CFS_HIGH_WEIGHT or CFS_LOW_WEIGHT, Linux's
+ * weights for nice -5 and 5.
+ *
+ * A task joins a run queue at the queue's min_vruntime, so newcomers
+ * neither starve the others nor get starved. Off a queue its vruntime
+ * is kept relative to the min_vruntime of the one it left.
+ */
+
+#define CFS_WEIGHT 1024
+#define CFS_HIGH_WEIGHT 3121
+#define CFS_LOW_WEIGHT 335
+#define CFS_MIN_CHARGE_DIV 4
+
+struct cfs_rq {
+  struct rb_root tree;
+  long long min_vruntime;   /* never decreases */
+};
+
+static int cfs_less(const struct rb_node* a, const struct rb_node* b) {
+  return rb_entry(a, node, rb)->vruntime < rb_entry(b, node, rb)->vruntime;
+}
+
+static void cfs_init(struct runqueue* rq) {
+  rq->priv = calloc(1, sizeof(struct cfs_rq));
+  if (rq->priv == NULL) {
+    perror("cfs_init: calloc");
+    exit(1);
+  }
+}
+
+static void cfs_destroy(struct runqueue* rq) {
+  /* The tree is threaded through the tasks: nothing else to free */
+  free(rq->priv);
+  rq->priv = NULL;
+}
+
+static void cfs_update_min(struct cfs_rq* cq) {
+  struct rb_node* first = rb_first(&cq->tree);
+  if (first != NULL && rb_entry(first, node, rb)->vruntime > cq->min_vruntime) {
+    cq->min_vruntime = rb_entry(first, node, rb)->vruntime;
+  }
+}
+
+static void cfs_enqueue(struct runqueue* rq, node* t) {
+  struct cfs_rq* cq = rq->priv;
+  if (t->weight == 0) {
+    t->weight = CFS_WEIGHT;
+  }
+  t->vruntime += cq->min_vruntime;
+  rb_insert(&cq->tree, &t->rb, cfs_less);
+}
+
+static void cfs_dequeue(struct runqueue* rq, node* t) {
+  struct cfs_rq* cq = rq->priv;
+  rb_erase(&cq->tree, &t->rb);
+  t->vruntime -= cq->min_vruntime;
+}
+
+static void cfs_on_exit(struct runqueue* rq, node* t) {
+  struct cfs_rq* cq = rq->priv;
+  rb_erase(&cq->tree, &t->rb);
+}
+
+static node* cfs_pick_next(struct runqueue* rq) {
+  struct cfs_rq* cq = rq->priv;
+  struct rb_node* first = rb_first(&cq->tree);
+  return (first != NULL) ? rb_entry(first, node, rb) : NULL;
+}
+
+/* Charge the slice and put the task back in vruntime order */
+static void cfs_on_quantum_expired(struct runqueue* rq, node* t) {
+  struct cfs_rq* cq = rq->priv;
+  long long charge = sched_tq_msec * 1000000LL / CFS_MIN_CHARGE_DIV;
+  if (t->slice_ns > charge) {
+    charge = t->slice_ns;
+  }
+  rb_erase(&cq->tree, &t->rb);
+  t->vruntime += charge * CFS_WEIGHT / t->weight;
+  rb_insert(&cq->tree, &t->rb, cfs_less);
+  cfs_update_min(cq);
+}
+
+/* Migrate the task furthest from running, the one that has had the most */
+static node* cfs_steal(struct runqueue* rq, node* running) {
+  struct cfs_rq* cq = rq->priv;
+  struct rb_node* n = rb_last(&cq->tree);
+  if (n != NULL && rb_entry(n, node, rb) == running) {
+    n = rb_prev(n);
+  }
+  return (n != NULL) ? rb_entry(n, node, rb) : NULL;
+}
+
+/* Only future slices are charged at the new weight */
+static int cfs_set_priority(struct runqueue* rq, node* t, int high) {
+  t->weight = high ? CFS_HIGH_WEIGHT : CFS_LOW_WEIGHT;
+  return 0;
+}
+
+static void cfs_show(node* t, char* buf, int len) {
+  snprintf(buf, len, "vruntime: %lldms\tweight: %d", t->vruntime / 1000000, t->weight);
+}
+
+struct sched_policy cfs_policy = {
+  .name = "cfs",
+  .init = cfs_init,
+  .destroy = cfs_destroy,
+  .enqueue = cfs_enqueue,
+  .dequeue = cfs_dequeue,
+  .pick_next = cfs_pick_next,
+  .on_quantum_expired = cfs_on_quantum_expired,
+  .on_exit = cfs_on_exit,
+  .steal = cfs_steal,
+  .set_priority = cfs_set_priority,
+  .show = cfs_show,
+};
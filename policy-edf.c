@@ -0,0 +1,186 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+#include "task-heap.h"
+#include "task-ring.h"
+
+/*
+ * Earliest deadline first.
+ *
+ * Tasks started with a deadline (e -d) are kept in a binary min-heap
+ * ordered by deadline, so the most urgent one is found in O(1) and
+ * tasks come and go in O(log n). A newcomer with an earlier deadline
+ * than the running task preempts it at once. Tasks without a deadline
+ * run round robin, only while no task with a deadline is runnable.
+ *
+ * A deadline is only accepted with admission control: sorted by
+ * deadline, the work left of every task due by each deadline, the new
+ * one included, has to fit in the time left until then on the slots
+ * there are. With one slot that is exact for EDF; with more it is
+ * necessary but not sufficient, as EDF can't split a task across
+ * slots. The work left is the runtime the task gave minus the CPU time
+ * it has used; tasks running over their estimate count for nothing.
+ *
+ * Deadlines aren't enforced beyond that: a task that misses its
+ * deadline keeps its place in the heap, where it comes first, and the
+ * miss is shown in the task listing (and the core reports it when the
+ * task exits).
+ */
+
+#define EDF_ADMIT_MIN 16
+
+struct edf_rq {
+  struct task_heap heap;   /* by deadline */
+  struct task_ring queue;  /* tasks without a deadline */
+};
+
+static void edf_init(struct runqueue* rq) {
+  struct edf_rq* eq = calloc(1, sizeof(struct edf_rq));
+  if (eq == NULL) {
+    perror("edf_init: calloc");
+    exit(1);
+  }
+  heap_init(&eq->heap, offsetof(node, deadline_ns));
+  ring_init(&eq->queue);
+  rq->priv = eq;
+}
+
+static void edf_destroy(struct runqueue* rq) {
+  struct edf_rq* eq = rq->priv;
+  heap_free(&eq->heap);
+  ring_free(&eq->queue);
+  free(eq);
+  rq->priv = NULL;
+}
+
+static void edf_enqueue(struct runqueue* rq, node* t) {
+  struct edf_rq* eq = rq->priv;
+  if (t->deadline_ns == 0) {
+    ring_push(&eq->queue, t);
+  } else {
+    heap_push(&eq->heap, t);
+  }
+}
+
+static void edf_dequeue(struct runqueue* rq, node* t) {
+  struct edf_rq* eq = rq->priv;
+  if (t->deadline_ns == 0) {
+    ring_remove(&eq->queue, t);
+  } else {
+    heap_remove(&eq->heap, t);
+  }
+}
+
+static node* edf_pick_next(struct runqueue* rq) {
+  struct edf_rq* eq = rq->priv;
+  node* t = heap_min(&eq->heap);
+  return t != NULL ? t : ring_head(&eq->queue);
+}
+
+/* Deadlines don't move: only tasks without one take turns */
+static void edf_on_quantum_expired(struct runqueue* rq, node* t) {
+  struct edf_rq* eq = rq->priv;
+  t->ran_ns += t->slice_ns;
+  if (t->deadline_ns == 0) {
+    ring_requeue(&eq->queue, t);
+  }
+}
+
+/* Migrate tasks without a deadline first, then a leaf of the heap */
+static node* edf_steal(struct runqueue* rq, node* running) {
+  struct edf_rq* eq = rq->priv;
+  node* t = ring_tail(&eq->queue, running);
+  if (t == NULL && eq->heap.len > 0 && eq->heap.v[eq->heap.len - 1] != running) {
+    t = eq->heap.v[eq->heap.len - 1];
+  }
+  return t;
+}
+
+static int edf_preempts(struct runqueue* rq, node* t, node* running) {
+  return t->deadline_ns != 0 &&
+         (running->deadline_ns == 0 || t->deadline_ns < running->deadline_ns);
+}
+
+static int edf_deadline_cmp(const void* a, const void* b) {
+  long long da = (*(node* const*)a)->deadline_ns;
+  long long db = (*(node* const*)b)->deadline_ns;
+  return (da > db) - (da < db);
+}
+
+/* Add t to the tasks for admission control, growing the array as needed */
+static void edf_collect(node*** tasks, int* n, int* cap, node* t) {
+  if (*n == *cap) {
+    *cap = *cap ? 2 * *cap : EDF_ADMIT_MIN;
+    *tasks = realloc(*tasks, *cap * sizeof(**tasks));
+    if (*tasks == NULL) {
+      perror("edf_admit: realloc");
+      exit(1);
+    }
+  }
+  (*tasks)[(*n)++] = t;
+}
+
+static int edf_admit(long long now, long long deadline_ns, long long runtime_ns,
+                     int nslots) {
+  node candidate = { .deadline_ns = deadline_ns, .runtime_ns = runtime_ns };
+  node** tasks = NULL;
+  node* t = proc_list;
+  long long demand = 0, left;
+  int n = 0, cap = 0, i, ret = 0;
+
+  /* Every task with a deadline, on a run queue or still starting */
+  edf_collect(&tasks, &n, &cap, &candidate);
+  if (t != NULL) {
+    do {
+      if (t->deadline_ns != 0) {
+        edf_collect(&tasks, &n, &cap, t);
+      }
+      t = t->next;
+    } while (t != proc_list);
+  }
+
+  qsort(tasks, n, sizeof(*tasks), edf_deadline_cmp);
+  for (i = 0; i < n; i++) {
+    left = tasks[i]->runtime_ns - tasks[i]->ran_ns;
+    if (left > 0) {
+      demand += left;
+    }
+    /* Those already late can't be helped: only their work counts */
+    if (tasks[i]->deadline_ns > now &&
+        demand > (tasks[i]->deadline_ns - now) * nslots) {
+      ret = -EBUSY;
+      break;
+    }
+  }
+  free(tasks);
+  return ret;
+}
+
+static void edf_show(node* t, char* buf, int len) {
+  long long left;
+  if (t->deadline_ns == 0) {
+    snprintf(buf, len, "deadline: none");
+    return;
+  }
+  left = t->deadline_ns - policy_now_ns();
+  snprintf(buf, len, "deadline: %s %lldms\tran: %lld/%lldms",
+           left >= 0 ? "in" : "MISSED by", (left >= 0 ? left : -left) / 1000000,
+           t->ran_ns / 1000000, t->runtime_ns / 1000000);
+}
+
+struct sched_policy edf_policy = {
+  .name = "edf",
+  .init = edf_init,
+  .destroy = edf_destroy,
+  .enqueue = edf_enqueue,
+  .dequeue = edf_dequeue,
+  .pick_next = edf_pick_next,
+  .on_quantum_expired = edf_on_quantum_expired,
+  .on_exit = edf_dequeue,
+  .steal = edf_steal,
+  .show = edf_show,
+  .preempts = edf_preempts,
+  .admit = edf_admit,
+};
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "policy.h"
+
+/*
+ * Lottery scheduling: every slice goes to the holder of a ticket drawn
+ * at random, so each task gets a share of the CPU proportional to its
+ * tickets. h and l give a task LOTTERY_HIGH_TICKETS or
+ * LOTTERY_LOW_TICKETS, the shell's n command any number.
+ *
+ * The tasks of a run queue are kept in an array, and a Fenwick tree over
+ * their tickets holds the running totals, so the winner of a draw is
+ * found by descending the tree in O(log n) rather than by walking the
+ * tasks, and adding, removing or reticketing a task is O(log n) too.
+ */
+
+#define LOTTERY_TICKETS 100
+#define LOTTERY_HIGH_TICKETS 400
+#define LOTTERY_LOW_TICKETS 25
+#define LOTTERY_MIN_CAP 16
+
+struct lottery_rq {
+  node** tasks;   /* task i holds the tickets at i + 1 in the tree */
+  long* tree;     /* Fenwick tree, 1-based, cap + 1 entries */
+  int len, cap;   /* cap is a power of two */
+  long total;     /* tickets held by the tasks on the queue */
+};
+
+static void lottery_init(struct runqueue* rq) {
+  rq->priv = calloc(1, sizeof(struct lottery_rq));
+  if (rq->priv == NULL) {
+    perror("lottery_init: calloc");
+    exit(1);
+  }
+  if (rq->cpu == 0) {
+    srand(time(NULL) ^ getpid());
+  }
+}
+
+static void lottery_destroy(struct runqueue* rq) {
+  struct lottery_rq* lq = rq->priv;
+  free(lq->tasks);
+  free(lq->tree);
+  free(lq);
+  rq->priv = NULL;
+}
+
+/* Add n tickets at array index i */
+static void tree_add(struct lottery_rq* lq, int i, long n) {
+  for (i++; i <= lq->cap; i += i & -i) {
+    lq->tree[i] += n;
+  }
+  lq->total += n;
+}
+
+/* Double the array, rebuilding the tree for the new size in O(n) */
+static void lottery_grow(struct lottery_rq* lq) {
+  int i, up;
+  lq->cap = lq->cap ? 2 * lq->cap : LOTTERY_MIN_CAP;
+  lq->tasks = realloc(lq->tasks, lq->cap * sizeof(*lq->tasks));
+  free(lq->tree);
+  lq->tree = calloc(lq->cap + 1, sizeof(*lq->tree));
+  if (lq->tasks == NULL || lq->tree == NULL) {
+    perror("lottery_grow: alloc");
+    exit(1);
+  }
+  for (i = 1; i <= lq->cap; i++) {
+    if (i <= lq->len) {
+      lq->tree[i] += lq->tasks[i - 1]->tickets;
+    }
+    up = i + (i & -i);
+    if (up <= lq->cap) {
+      lq->tree[up] += lq->tree[i];
+    }
+  }
+}
+
+static void lottery_enqueue(struct runqueue* rq, node* t) {
+  struct lottery_rq* lq = rq->priv;
+  if (t->tickets == 0) {
+    t->tickets = LOTTERY_TICKETS;
+  }
+  if (lq->len == lq->cap) {
+    lottery_grow(lq);
+  }
+  t->rq_idx = lq->len++;
+  lq->tasks[t->rq_idx] = t;
+  tree_add(lq, t->rq_idx, t->tickets);
+}
+
+/* The last task moves into the hole */
+static void lottery_dequeue(struct runqueue* rq, node* t) {
+  struct lottery_rq* lq = rq->priv;
+  node* last = lq->tasks[--lq->len];
+  tree_add(lq, t->rq_idx, -t->tickets);
+  if (last != t) {
+    tree_add(lq, lq->len, -last->tickets);
+    last->rq_idx = t->rq_idx;
+    lq->tasks[last->rq_idx] = last;
+    tree_add(lq, last->rq_idx, last->tickets);
+  }
+}
+
+static node* lottery_pick_next(struct runqueue* rq) {
+  struct lottery_rq* lq = rq->priv;
+  long winner;
+  int pos = 0, step;
+
+  if (lq->len == 0) {
+    return NULL;
+  }
+  winner = (long)((double)rand() / ((double)RAND_MAX + 1) * lq->total);
+  /* The first task whose running total exceeds winner */
+  for (step = lq->cap; step > 0; step >>= 1) {
+    if (pos + step <= lq->cap && lq->tree[pos + step] <= winner) {
+      pos += step;
+      winner -= lq->tree[pos];
+    }
+  }
+  return lq->tasks[pos];
+}
+
+/* The draw doesn't depend on queue order, nothing to do */
+static void lottery_on_quantum_expired(struct runqueue* rq, node* t) {
+}
+
+static node* lottery_steal(struct runqueue* rq, node* running) {
+  struct lottery_rq* lq = rq->priv;
+  int i = lq->len - 1;
+  if (i >= 0 && lq->tasks[i] == running) {
+    i--;
+  }
+  return i >= 0 ? lq->tasks[i] : NULL;
+}
+
+static int lottery_set_tickets(struct runqueue* rq, node* t, int tickets) {
+  struct lottery_rq* lq = rq->priv;
+  tree_add(lq, t->rq_idx, tickets - t->tickets);
+  t->tickets = tickets;
+  return 0;
+}
+
+static int lottery_set_priority(struct runqueue* rq, node* t, int high) {
+  return lottery_set_tickets(rq, t, high ? LOTTERY_HIGH_TICKETS : LOTTERY_LOW_TICKETS);
+}
+
+static void lottery_show(node* t, char* buf, int len) {
+  snprintf(buf, len, "tickets: %d", t->tickets);
+}
+
+struct sched_policy lottery_policy = {
+  .name = "lottery",
+  .init = lottery_init,
+  .destroy = lottery_destroy,
+  .enqueue = lottery_enqueue,
+  .dequeue = lottery_dequeue,
+  .pick_next = lottery_pick_next,
+  .on_quantum_expired = lottery_on_quantum_expired,
+  .on_exit = lottery_dequeue,
+  .steal = lottery_steal,
+  .set_priority = lottery_set_priority,
+  .set_tickets = lottery_set_tickets,
+  .show = lottery_show,
+};
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+#include "task-ring.h"
+
+/*
+ * Multi-level feedback queue.
+ *
+ * Level l has its own run queue and a quantum of sched_tq_msec << l.
+ * The CPU time a task uses is charged to its level; once it has used
+ * up the level's quantum it is demoted. Every mlfq_boost_msec all tasks
+ * go back to level 0, so that nothing starves.
+ */
+
+#define MLFQ_DEFAULT_LEVELS 3
+#define MLFQ_BOOST_MSEC 5000          /* default priority boost period (ms) */
+
+int mlfq_levels = 0;                  /* 0 means MLFQ_DEFAULT_LEVELS */
+long mlfq_boost_msec = MLFQ_BOOST_MSEC;
+
+struct mlfq_rq {
+  struct task_ring queue[MLFQ_MAX_LEVELS];
+  long long last_boost_ns;
+  node* skip;   /* passed over by the next pick, see mlfq_on_quantum_expired() */
+};
+
+static void mlfq_init(struct runqueue* rq) {
+  struct mlfq_rq* mq;
+  int l;
+  if (mlfq_levels == 0) {
+    mlfq_levels = MLFQ_DEFAULT_LEVELS;
+  }
+  mq = calloc(1, sizeof(struct mlfq_rq));
+  if (mq == NULL) {
+    perror("mlfq_init: calloc");
+    exit(1);
+  }
+  for (l = 0; l < MLFQ_MAX_LEVELS; l++) {
+    ring_init(&mq->queue[l]);
+  }
+  mq->last_boost_ns = policy_now_ns();
+  rq->priv = mq;
+}
+
+static void mlfq_destroy(struct runqueue* rq) {
+  struct mlfq_rq* mq = rq->priv;
+  int l;
+  for (l = 0; l < MLFQ_MAX_LEVELS; l++) {
+    ring_free(&mq->queue[l]);
+  }
+  free(mq);
+  rq->priv = NULL;
+}
+
+static long mlfq_quantum(node* t) {
+  return sched_tq_msec << t->level;
+}
+
+static void mlfq_enqueue(struct runqueue* rq, node* t) {
+  struct mlfq_rq* mq = rq->priv;
+  ring_push(&mq->queue[t->level], t);
+}
+
+static void mlfq_dequeue(struct runqueue* rq, node* t) {
+  struct mlfq_rq* mq = rq->priv;
+  ring_remove(&mq->queue[t->level], t);
+  if (mq->skip == t) {
+    mq->skip = NULL;
+  }
+}
+
+/* Move a task to another level, starting afresh there */
+static void mlfq_set_level(struct mlfq_rq* mq, node* t, int level) {
+  ring_remove(&mq->queue[t->level], t);
+  t->level = level;
+  t->used_ns = 0;
+  ring_push(&mq->queue[t->level], t);
+}
+
+/* Move every task back to the top level */
+static void mlfq_boost(struct mlfq_rq* mq) {
+  node* t;
+  int l;
+  for (l = 1; l < mlfq_levels; l++) {
+    while ((t = ring_head(&mq->queue[l])) != NULL) {
+      mlfq_set_level(mq, t, 0);
+    }
+  }
+  mq->last_boost_ns = policy_now_ns();
+}
+
+/*
+ * Charge the slice to the task's level and demote it once the level's
+ * quantum is used up; otherwise it goes to the back of its queue.
+ *
+ * We only see quantum expiry, not blocking. A task that slept through
+ * most of its slice (e.g. the shell waiting for input) lets the lower
+ * levels run next instead of hogging the top queue.
+ */
+static void mlfq_on_quantum_expired(struct runqueue* rq, node* t) {
+  struct mlfq_rq* mq = rq->priv;
+  long long quantum_ns = mlfq_quantum(t) * 1000000LL;
+
+  t->used_ns += t->slice_ns;
+  if (t->used_ns >= quantum_ns && t->level < mlfq_levels - 1) {
+    mlfq_set_level(mq, t, t->level + 1);
+  } else {
+    ring_requeue(&mq->queue[t->level], t);
+  }
+  mq->skip = t->slice_ns < quantum_ns / 2 ? t : NULL;
+}
+
+/* Pick the head of the highest non-empty level, boosting first if due */
+static node* mlfq_pick_next(struct runqueue* rq) {
+  struct mlfq_rq* mq = rq->priv;
+  node* skip = mq->skip;
+  node* next = NULL;
+  int l;
+
+  mq->skip = NULL;
+  if (policy_now_ns() - mq->last_boost_ns >= mlfq_boost_msec * 1000000LL) {
+    mlfq_boost(mq);
+  }
+
+  for (l = 0; l < mlfq_levels && next == NULL; l++) {
+    next = ring_head(&mq->queue[l]);
+    if (next == skip && next != NULL && mq->queue[l].len == 1) {
+      next = NULL;
+    }
+  }
+  if (next == NULL) {
+    next = skip;
+  }
+  return next;
+}
+
+/* Migrate from the lowest levels first, they are the CPU hogs */
+static node* mlfq_steal(struct runqueue* rq, node* running) {
+  struct mlfq_rq* mq = rq->priv;
+  node* t = NULL;
+  int l;
+
+  for (l = mlfq_levels - 1; l >= 0 && t == NULL; l--) {
+    t = ring_tail(&mq->queue[l], running);
+  }
+  return t;
+}
+
+/* h moves a task to the top level, l to the bottom one */
+static int mlfq_set_priority(struct runqueue* rq, node* t, int high) {
+  mlfq_set_level(rq->priv, t, high ? 0 : mlfq_levels - 1);
+  return 0;
+}
+
+static void mlfq_show(node* t, char* buf, int len) {
+  snprintf(buf, len, "level: %d", t->level);
+}
+
+struct sched_policy mlfq_policy = {
+  .name = "mlfq",
+  .init = mlfq_init,
+  .destroy = mlfq_destroy,
+  .enqueue = mlfq_enqueue,
+  .dequeue = mlfq_dequeue,
+  .pick_next = mlfq_pick_next,
+  .on_quantum_expired = mlfq_on_quantum_expired,
+  .on_exit = mlfq_dequeue,
+  .steal = mlfq_steal,
+  .quantum = mlfq_quantum,
+  .set_priority = mlfq_set_priority,
+  .show = mlfq_show,
+};
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+#include "task-ring.h"
+
+/*
+ * Two priority bands. HIGH tasks are run round robin among themselves;
+ * LOW tasks only get the CPU while there are no HIGH tasks.
+ * All tasks start LOW.
+ */
+
+struct prio_rq {
+  struct task_ring queue[2];
+};
+
+static void prio_init(struct runqueue* rq) {
+  struct prio_rq* pr = calloc(1, sizeof(struct prio_rq));
+  if (pr == NULL) {
+    perror("prio_init: calloc");
+    exit(1);
+  }
+  ring_init(&pr->queue[0]);
+  ring_init(&pr->queue[1]);
+  rq->priv = pr;
+}
+
+static void prio_destroy(struct runqueue* rq) {
+  struct prio_rq* pr = rq->priv;
+  ring_free(&pr->queue[0]);
+  ring_free(&pr->queue[1]);
+  free(pr);
+  rq->priv = NULL;
+}
+
+static void prio_enqueue(struct runqueue* rq, node* t) {
+  struct prio_rq* pr = rq->priv;
+  ring_push(&pr->queue[t->priority], t);
+}
+
+static void prio_dequeue(struct runqueue* rq, node* t) {
+  struct prio_rq* pr = rq->priv;
+  ring_remove(&pr->queue[t->priority], t);
+}
+
+static node* prio_pick_next(struct runqueue* rq) {
+  struct prio_rq* pr = rq->priv;
+  if (pr->queue[1].len > 0) {
+    return ring_head(&pr->queue[1]);
+  }
+  return ring_head(&pr->queue[0]);
+}
+
+static void prio_on_quantum_expired(struct runqueue* rq, node* t) {
+  struct prio_rq* pr = rq->priv;
+  ring_requeue(&pr->queue[t->priority], t);
+}
+
+/* Migrate LOW tasks first, they are the ones waiting */
+static node* prio_steal(struct runqueue* rq, node* running) {
+  struct prio_rq* pr = rq->priv;
+  node* t = ring_tail(&pr->queue[0], running);
+  if (t == NULL) {
+    t = ring_tail(&pr->queue[1], running);
+  }
+  return t;
+}
+
+static int prio_set_priority(struct runqueue* rq, node* t, int high) {
+  prio_dequeue(rq, t);
+  t->priority = high;
+  prio_enqueue(rq, t);
+  return 0;
+}
+
+static void prio_show(node* t, char* buf, int len) {
+  snprintf(buf, len, "priority: %s", t->priority ? "HIGH" : "LOW");
+}
+
+struct sched_policy prio_policy = {
+  .name = "prio",
+  .init = prio_init,
+  .destroy = prio_destroy,
+  .enqueue = prio_enqueue,
+  .dequeue = prio_dequeue,
+  .pick_next = prio_pick_next,
+  .on_quantum_expired = prio_on_quantum_expired,
+  .on_exit = prio_dequeue,
+  .steal = prio_steal,
+  .set_priority = prio_set_priority,
+  .show = prio_show,
+};
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+#include "task-ring.h"
+
+/*
+ * Round robin: a single run queue, every task gets the base quantum
+ * in turn.
+ */
+
+struct rr_rq {
+  struct task_ring queue;
+};
+
+static void rr_init(struct runqueue* rq) {
+  struct rr_rq* rr = calloc(1, sizeof(struct rr_rq));
+  if (rr == NULL) {
+    perror("rr_init: calloc");
+    exit(1);
+  }
+  ring_init(&rr->queue);
+  rq->priv = rr;
+}
+
+static void rr_destroy(struct runqueue* rq) {
+  struct rr_rq* rr = rq->priv;
+  ring_free(&rr->queue);
+  free(rr);
+  rq->priv = NULL;
+}
+
+static void rr_enqueue(struct runqueue* rq, node* t) {
+  struct rr_rq* rr = rq->priv;
+  ring_push(&rr->queue, t);
+}
+
+static void rr_dequeue(struct runqueue* rq, node* t) {
+  struct rr_rq* rr = rq->priv;
+  ring_remove(&rr->queue, t);
+}
+
+static node* rr_pick_next(struct runqueue* rq) {
+  struct rr_rq* rr = rq->priv;
+  return ring_head(&rr->queue);
+}
+
+/* Send the task to the back of the queue */
+static void rr_on_quantum_expired(struct runqueue* rq, node* t) {
+  struct rr_rq* rr = rq->priv;
+  ring_requeue(&rr->queue, t);
+}
+
+static node* rr_steal(struct runqueue* rq, node* running) {
+  struct rr_rq* rr = rq->priv;
+  return ring_tail(&rr->queue, running);
+}
+
+struct sched_policy rr_policy = {
+  .name = "rr",
+  .init = rr_init,
+  .destroy = rr_destroy,
+  .enqueue = rr_enqueue,
+  .dequeue = rr_dequeue,
+  .pick_next = rr_pick_next,
+  .on_quantum_expired = rr_on_quantum_expired,
+  .on_exit = rr_dequeue,
+  .steal = rr_steal,
+};
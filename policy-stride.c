@@ -0,0 +1,132 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "policy.h"
+#include "task-heap.h"
+
+/*
+ * Stride scheduling: the deterministic counterpart of the lottery.
+ * Every task has a stride of STRIDE_ONE / tickets and a pass; the task
+ * with the smallest pass runs next and its pass then advances by its
+ * stride, so over any interval each task gets its share of the quanta
+ * to within one, instead of only on average. The passes are kept in a
+ * min-heap, so picking is O(1) and requeueing O(log n).
+ *
+ * A task joins a run queue at the queue's current pass and keeps what
+ * it had left over relative to it when it leaves. Changing a task's
+ * tickets scales what it has left of its current stride.
+ *
+ * h and l give a task STRIDE_HIGH_TICKETS or STRIDE_LOW_TICKETS, the
+ * shell's n command any number.
+ */
+
+#define STRIDE_ONE (1LL << 20)
+#define STRIDE_TICKETS 100
+#define STRIDE_HIGH_TICKETS 400
+#define STRIDE_LOW_TICKETS 25
+
+struct stride_rq {
+  struct task_heap heap;   /* by pass */
+  long long pass;          /* smallest pass on the queue, never decreases */
+};
+
+static void stride_init(struct runqueue* rq) {
+  struct stride_rq* sq = calloc(1, sizeof(struct stride_rq));
+  if (sq == NULL) {
+    perror("stride_init: calloc");
+    exit(1);
+  }
+  heap_init(&sq->heap, offsetof(node, pass));
+  rq->priv = sq;
+}
+
+static void stride_destroy(struct runqueue* rq) {
+  struct stride_rq* sq = rq->priv;
+  heap_free(&sq->heap);
+  free(sq);
+  rq->priv = NULL;
+}
+
+static void stride_update_pass(struct stride_rq* sq) {
+  node* first = heap_min(&sq->heap);
+  if (first != NULL && first->pass > sq->pass) {
+    sq->pass = first->pass;
+  }
+}
+
+static void stride_enqueue(struct runqueue* rq, node* t) {
+  struct stride_rq* sq = rq->priv;
+  if (t->tickets == 0) {
+    t->tickets = STRIDE_TICKETS;
+  }
+  t->pass += sq->pass;
+  heap_push(&sq->heap, t);
+}
+
+static void stride_dequeue(struct runqueue* rq, node* t) {
+  struct stride_rq* sq = rq->priv;
+  heap_remove(&sq->heap, t);
+  t->pass -= sq->pass;
+}
+
+static void stride_on_exit(struct runqueue* rq, node* t) {
+  struct stride_rq* sq = rq->priv;
+  heap_remove(&sq->heap, t);
+}
+
+static node* stride_pick_next(struct runqueue* rq) {
+  struct stride_rq* sq = rq->priv;
+  return heap_min(&sq->heap);
+}
+
+static void stride_on_quantum_expired(struct runqueue* rq, node* t) {
+  struct stride_rq* sq = rq->priv;
+  t->pass += STRIDE_ONE / t->tickets;
+  heap_fix(&sq->heap, t);
+  stride_update_pass(sq);
+}
+
+/* A leaf of the heap: one of the tasks furthest from running */
+static node* stride_steal(struct runqueue* rq, node* running) {
+  struct stride_rq* sq = rq->priv;
+  int i = sq->heap.len - 1;
+  if (i >= 0 && sq->heap.v[i] == running) {
+    i--;
+  }
+  return i >= 0 ? sq->heap.v[i] : NULL;
+}
+
+static int stride_set_tickets(struct runqueue* rq, node* t, int tickets) {
+  struct stride_rq* sq = rq->priv;
+  long long left = t->pass - sq->pass;
+  if (left > 0) {
+    t->pass = sq->pass + left * t->tickets / tickets;
+  }
+  t->tickets = tickets;
+  heap_fix(&sq->heap, t);
+  return 0;
+}
+
+static int stride_set_priority(struct runqueue* rq, node* t, int high) {
+  return stride_set_tickets(rq, t, high ? STRIDE_HIGH_TICKETS : STRIDE_LOW_TICKETS);
+}
+
+static void stride_show(node* t, char* buf, int len) {
+  snprintf(buf, len, "tickets: %d\tpass: %lld", t->tickets, t->pass);
+}
+
+struct sched_policy stride_policy = {
+  .name = "stride",
+  .init = stride_init,
+  .destroy = stride_destroy,
+  .enqueue = stride_enqueue,
+  .dequeue = stride_dequeue,
+  .pick_next = stride_pick_next,
+  .on_quantum_expired = stride_on_quantum_expired,
+  .on_exit = stride_on_exit,
+  .steal = stride_steal,
+  .set_priority = stride_set_priority,
+  .set_tickets = stride_set_tickets,
+  .show = stride_show,
+};
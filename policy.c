@@ -0,0 +1,24 @@
+#include <string.h>
+
+#include "policy.h"
+
+struct sched_policy *sched_policies[] = {
+	&rr_policy,
+	&prio_policy,
+	&mlfq_policy,
+	&lottery_policy,
+	&cfs_policy,
+	&edf_policy,
+	&stride_policy,
+	NULL
+};
+
+struct sched_policy *find_policy(const char *name)
+{
+	int i;
+
+	for (i = 0; sched_policies[i] != NULL; i++)
+		if (strcmp(sched_policies[i]->name, name) == 0)
+			return sched_policies[i];
+	return NULL;
+}
@@ -0,0 +1,121 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "task-list.h"
+
+/******************************************************************************
+ * Scheduling policies.
+ *
+ * The scheduler core owns the processes: it forks them, stops and
+ * continues them and reaps them. A policy only decides the order in
+ * which runnable tasks get the CPU, through the hooks below.
+ *
+ * A task is on the policy's run queue from enqueue() until dequeue() or
+ * on_exit(), including while it is running.
+ */
+
+/* A per-CPU run queue. priv holds the policy's own queues. */
+struct runqueue {
+	int cpu;
+	int nr;          /* tasks on this run queue, maintained by the core */
+	void *priv;
+};
+
+struct sched_policy {
+	const char *name;
+
+	/* Set up the policy's state for a run queue. */
+	void (*init)(struct runqueue *rq);
+
+	/* Free what init() set up, once rq has no tasks left. */
+	void (*destroy)(struct runqueue *rq);
+
+	/* A task has been added to rq (created or migrated). */
+	void (*enqueue)(struct runqueue *rq, node *t);
+
+	/* Take a task off rq. */
+	void (*dequeue)(struct runqueue *rq, node *t);
+
+	/* Choose the task to run next on rq, NULL if there is none. */
+	node *(*pick_next)(struct runqueue *rq);
+
+	/*
+	 * The running task has been stopped at the end of its slice.
+	 * t->slice_ns holds the CPU time it used during the slice.
+	 */
+	void (*on_quantum_expired)(struct runqueue *rq, node *t);
+
+	/* A task has exited. It is freed right after this returns. */
+	void (*on_exit)(struct runqueue *rq, node *t);
+
+	/*
+	 * Choose a task other than running to move to another run queue,
+	 * NULL if there is none. It is then dequeue()d by the core.
+	 */
+	node *(*steal)(struct runqueue *rq, node *running);
+
+	/* Length of t's next slice in ms. NULL means the base quantum. */
+	long (*quantum)(node *t);
+
+	/* Shell h/l requests. NULL if the policy has no priorities. */
+	int (*set_priority)(struct runqueue *rq, node *t, int high);
+
+	/*
+	 * Shell n requests: give t tickets, 1 to SCHED_MAX_TICKETS.
+	 * NULL if the policy has no tickets.
+	 */
+	int (*set_tickets)(struct runqueue *rq, node *t, int tickets);
+
+	/* Format the policy's view of a task for the task listing. */
+	void (*show)(node *t, char *buf, int len);
+
+	/*
+	 * A task t has just been enqueued on rq, where running has the CPU:
+	 * whether running is to be stopped right away rather than at the
+	 * end of its quantum. NULL means never.
+	 */
+	int (*preempts)(struct runqueue *rq, node *t, node *running);
+
+	/*
+	 * Admission control for a task that is to finish by deadline_ns
+	 * (CLOCK_MONOTONIC) and needs about runtime_ns of CPU, on nslots
+	 * slots: 0 if it can be admitted alongside every task already there
+	 * (all of proc_list), -EBUSY if not. NULL if the policy has no
+	 * deadlines.
+	 */
+	int (*admit)(long long now_ns, long long deadline_ns, long long runtime_ns,
+		     int nslots);
+};
+
+extern struct sched_policy rr_policy;
+extern struct sched_policy prio_policy;
+extern struct sched_policy mlfq_policy;
+extern struct sched_policy lottery_policy;
+extern struct sched_policy cfs_policy;
+extern struct sched_policy edf_policy;
+extern struct sched_policy stride_policy;
+
+/* Every policy, NULL-terminated */
+extern struct sched_policy *sched_policies[];
+
+/* Find a policy by name, NULL if there is no such policy. */
+struct sched_policy *find_policy(const char *name);
+
+/*
+ * The time in ns, as policies are to see it: CLOCK_MONOTONIC in the
+ * scheduler, virtual time in sched-sim, which runs the same policies.
+ */
+long long policy_now_ns(void);
+
+/* Most tickets a task can hold */
+#define SCHED_MAX_TICKETS 1000000
+
+/* Base time quantum in ms, shared by all policies */
+extern long sched_tq_msec;
+
+/* MLFQ parameters */
+#define MLFQ_MAX_LEVELS 8             /* maximum number of MLFQ run queues */
+extern int mlfq_levels;
+extern long mlfq_boost_msec;
+
+#endif /* POLICY_H */
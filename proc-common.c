@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -155,3 +156,35 @@ void *create_shared_memory_area(unsigned int numbytes)
 
 	return addr;
 }
+
+void *create_shared_memory_file(unsigned int numbytes, int *fd)
+{
+	int pages;
+	void *addr;
+
+	if (numbytes == 0) {
+		fprintf(stderr, "%s: internal error: called for numbytes == 0\n", __func__);
+		exit(1);
+	}
+
+	pages = (numbytes - 1) / sysconf(_SC_PAGE_SIZE) + 1;
+
+	/* Same as above, but backed by a memfd that can be mapped again after exec() */
+	*fd = memfd_create("shared-memory-area", MFD_CLOEXEC);
+	if (*fd < 0) {
+		perror("create_shared_memory_file: memfd_create failed");
+		exit(1);
+	}
+	if (ftruncate(*fd, pages * sysconf(_SC_PAGE_SIZE)) < 0) {
+		perror("create_shared_memory_file: ftruncate failed");
+		exit(1);
+	}
+	addr = mmap(NULL, pages * sysconf(_SC_PAGE_SIZE),
+		PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+	if (addr == MAP_FAILED) {
+		perror("create_shared_memory_file: mmap failed");
+		exit(1);
+	}
+
+	return addr;
+}
@@ -36,4 +36,11 @@ void show_pstree(pid_t p);
  */
 void *create_shared_memory_area(unsigned int numbytes);
 
+/*
+ * Same, but backed by a file descriptor returned in *fd, so that the area
+ * can also be mapped by a program the descendant exec()s. The descriptor
+ * is close-on-exec: clear FD_CLOEXEC in the one descendant that needs it.
+ */
+void *create_shared_memory_file(unsigned int numbytes, int *fd);
+
 #endif /* PROC_COMMON_H */
@@ -0,0 +1,259 @@
+#include "rbtree.h"
+
+/*
+ * The classic algorithm (CLRS), with NULL leaves, which count as black.
+ */
+
+static void
+rb_set_child(struct rb_root *root, struct rb_node *parent,
+	     struct rb_node *old, struct rb_node *new)
+{
+	if (parent == NULL)
+		root->root = new;
+	else if (parent->left == old)
+		parent->left = new;
+	else
+		parent->right = new;
+}
+
+static void
+rb_rotate_left(struct rb_root *root, struct rb_node *x)
+{
+	struct rb_node *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	y->parent = x->parent;
+	rb_set_child(root, x->parent, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+static void
+rb_rotate_right(struct rb_root *root, struct rb_node *x)
+{
+	struct rb_node *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	y->parent = x->parent;
+	rb_set_child(root, x->parent, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+void
+rb_insert(struct rb_root *root, struct rb_node *n, rb_less_fn less)
+{
+	struct rb_node **link = &root->root, *parent = NULL, *g, *u;
+	int leftmost = 1;
+
+	while (*link != NULL) {
+		parent = *link;
+		if (less(n, parent)) {
+			link = &parent->left;
+		} else {
+			link = &parent->right;
+			leftmost = 0;
+		}
+	}
+	n->left = n->right = NULL;
+	n->parent = parent;
+	n->red = 1;
+	*link = n;
+	if (leftmost)
+		root->leftmost = n;
+
+	/* Two reds in a row: recolour while the uncle is red, else rotate */
+	while ((parent = n->parent) != NULL && parent->red) {
+		g = parent->parent;
+		if (parent == g->left) {
+			u = g->right;
+			if (u != NULL && u->red) {
+				parent->red = u->red = 0;
+				g->red = 1;
+				n = g;
+				continue;
+			}
+			if (n == parent->right) {
+				rb_rotate_left(root, parent);
+				n = parent;
+				parent = n->parent;
+			}
+			parent->red = 0;
+			g->red = 1;
+			rb_rotate_right(root, g);
+		} else {
+			u = g->left;
+			if (u != NULL && u->red) {
+				parent->red = u->red = 0;
+				g->red = 1;
+				n = g;
+				continue;
+			}
+			if (n == parent->left) {
+				rb_rotate_right(root, parent);
+				n = parent;
+				parent = n->parent;
+			}
+			parent->red = 0;
+			g->red = 1;
+			rb_rotate_left(root, g);
+		}
+	}
+	root->root->red = 0;
+}
+
+/* Restore the black heights after removing a black node above x. */
+static void
+rb_erase_fixup(struct rb_root *root, struct rb_node *x, struct rb_node *parent)
+{
+	struct rb_node *w;
+
+	while (x != root->root && (x == NULL || !x->red)) {
+		if (x == parent->left) {
+			w = parent->right;
+			if (w->red) {
+				w->red = 0;
+				parent->red = 1;
+				rb_rotate_left(root, parent);
+				w = parent->right;
+			}
+			if ((w->left == NULL || !w->left->red) &&
+			    (w->right == NULL || !w->right->red)) {
+				w->red = 1;
+				x = parent;
+				parent = x->parent;
+				continue;
+			}
+			if (w->right == NULL || !w->right->red) {
+				w->left->red = 0;
+				w->red = 1;
+				rb_rotate_right(root, w);
+				w = parent->right;
+			}
+			w->red = parent->red;
+			parent->red = 0;
+			w->right->red = 0;
+			rb_rotate_left(root, parent);
+		} else {
+			w = parent->left;
+			if (w->red) {
+				w->red = 0;
+				parent->red = 1;
+				rb_rotate_right(root, parent);
+				w = parent->left;
+			}
+			if ((w->left == NULL || !w->left->red) &&
+			    (w->right == NULL || !w->right->red)) {
+				w->red = 1;
+				x = parent;
+				parent = x->parent;
+				continue;
+			}
+			if (w->left == NULL || !w->left->red) {
+				w->right->red = 0;
+				w->red = 1;
+				rb_rotate_left(root, w);
+				w = parent->left;
+			}
+			w->red = parent->red;
+			parent->red = 0;
+			w->left->red = 0;
+			rb_rotate_right(root, parent);
+		}
+		x = root->root;
+		break;
+	}
+	if (x != NULL)
+		x->red = 0;
+}
+
+void
+rb_erase(struct rb_root *root, struct rb_node *n)
+{
+	struct rb_node *x, *parent, *succ;
+	int removed_red;
+
+	if (root->leftmost == n)
+		root->leftmost = rb_next(n);
+
+	if (n->left == NULL || n->right == NULL) {
+		/* At most one child: it takes n's place */
+		x = (n->left != NULL) ? n->left : n->right;
+		parent = n->parent;
+		removed_red = n->red;
+		if (x != NULL)
+			x->parent = parent;
+		rb_set_child(root, parent, n, x);
+	} else {
+		/* Two children: n's successor, which has no left child, moves up */
+		succ = n->right;
+		while (succ->left != NULL)
+			succ = succ->left;
+		removed_red = succ->red;
+		x = succ->right;
+		if (succ->parent == n) {
+			parent = succ;
+		} else {
+			parent = succ->parent;
+			parent->left = x;
+			if (x != NULL)
+				x->parent = parent;
+			succ->right = n->right;
+			n->right->parent = succ;
+		}
+		succ->left = n->left;
+		n->left->parent = succ;
+		succ->parent = n->parent;
+		succ->red = n->red;
+		rb_set_child(root, n->parent, n, succ);
+	}
+
+	if (!removed_red)
+		rb_erase_fixup(root, x, parent);
+}
+
+struct rb_node *
+rb_last(struct rb_root *root)
+{
+	struct rb_node *n = root->root;
+
+	if (n == NULL)
+		return NULL;
+	while (n->right != NULL)
+		n = n->right;
+	return n;
+}
+
+struct rb_node *
+rb_next(struct rb_node *n)
+{
+	struct rb_node *p;
+
+	if (n->right != NULL) {
+		for (n = n->right; n->left != NULL; n = n->left)
+			;
+		return n;
+	}
+	while ((p = n->parent) != NULL && n == p->right)
+		n = p;
+	return p;
+}
+
+struct rb_node *
+rb_prev(struct rb_node *n)
+{
+	struct rb_node *p;
+
+	if (n->left != NULL) {
+		for (n = n->left; n->right != NULL; n = n->right)
+			;
+		return n;
+	}
+	while ((p = n->parent) != NULL && n == p->left)
+		n = p;
+	return p;
+}
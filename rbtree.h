@@ -0,0 +1,51 @@
+#ifndef RBTREE_H
+#define RBTREE_H
+
+#include <stddef.h>
+
+/******************************************************************************
+ * Intrusive red-black tree.
+ *
+ * The nodes are embedded in the objects they order, which the caller
+ * gets back with rb_entry(). The order is given by a less() function at
+ * insertion; equal keys go after the ones already in the tree, so they
+ * come out first in, first out. The leftmost node is cached, so the
+ * minimum is O(1), insertion and removal O(log n).
+ */
+
+struct rb_node {
+	struct rb_node *left, *right, *parent;
+	int red;
+};
+
+struct rb_root {
+	struct rb_node *root;
+	struct rb_node *leftmost;
+};
+
+#define RB_ROOT_INIT { NULL, NULL }
+
+#define rb_entry(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+/* Does a sort before b? */
+typedef int (*rb_less_fn)(const struct rb_node *a, const struct rb_node *b);
+
+/* Add n to the tree. */
+void rb_insert(struct rb_root *root, struct rb_node *n, rb_less_fn less);
+
+/* Remove n, which must be in the tree. */
+void rb_erase(struct rb_root *root, struct rb_node *n);
+
+/* Smallest and largest node, NULL if the tree is empty. */
+static inline struct rb_node *rb_first(struct rb_root *root)
+{
+	return root->leftmost;
+}
+struct rb_node *rb_last(struct rb_root *root);
+
+/* In-order neighbours, NULL past either end. */
+struct rb_node *rb_next(struct rb_node *n);
+struct rb_node *rb_prev(struct rb_node *n);
+
+#endif /* RBTREE_H */
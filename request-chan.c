@@ -0,0 +1,255 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+
+#include "proc-common.h"
+#include "request-chan.h"
+
+#define RING_MASK (CHAN_RING_SIZE - 1)
+
+/* Both rings live in one shared mapping: [0] shell to scheduler, [1] back */
+static struct chan_ring *map_rings(int fd)
+{
+	void *addr = mmap(NULL, 2 * sizeof(struct chan_ring),
+			  PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	return (addr == MAP_FAILED) ? NULL : addr;
+}
+
+void chan_create(struct req_chan *ours, struct req_chan *peer, int shm)
+{
+	struct chan_ring *rings;
+	int rq[2], ret[2], memfd;
+
+	ours->shm = peer->shm = shm;
+	ours->tx = ours->rx = peer->tx = peer->rx = NULL;
+	ours->memfd = peer->memfd = -1;
+	ours->hupfd = ours->livefd = peer->hupfd = peer->livefd = -1;
+
+	if (!shm) {
+		if (pipe(rq) < 0 || pipe(ret) < 0) {
+			perror("pipe");
+			exit(1);
+		}
+		ours->rfd = rq[0];
+		peer->wfd = rq[1];
+		peer->rfd = ret[0];
+		ours->wfd = ret[1];
+		return;
+	}
+
+	rings = create_shared_memory_file(2 * sizeof(struct chan_ring), &memfd);
+	/*
+	 * Non-blocking, so that a spurious wakeup never stalls the event loop.
+	 * Like everything else here, close-on-exec, so that no task we run
+	 * keeps them open for us: chan_args() lets the shell's copies through.
+	 */
+	ours->rfd = peer->wfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	peer->rfd = ours->wfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ours->rfd < 0 || ours->wfd < 0) {
+		perror("eventfd");
+		exit(1);
+	}
+	if (pipe2(rq, O_CLOEXEC) < 0 || pipe2(ret, O_CLOEXEC) < 0) {
+		perror("pipe2");
+		exit(1);
+	}
+	ours->hupfd = rq[0];
+	peer->livefd = rq[1];
+	peer->hupfd = ret[0];
+	ours->livefd = ret[1];
+	ours->rx = peer->tx = &rings[0];
+	ours->tx = peer->rx = &rings[1];
+	peer->memfd = memfd;
+}
+
+int chan_args(struct req_chan *peer, char args[5][16])
+{
+	if (!peer->shm) {
+		sprintf(args[0], "%05d", peer->wfd);
+		sprintf(args[1], "%05d", peer->rfd);
+		return 2;
+	}
+	fcntl(peer->memfd, F_SETFD, 0);
+	fcntl(peer->wfd, F_SETFD, 0);
+	fcntl(peer->rfd, F_SETFD, 0);
+	fcntl(peer->hupfd, F_SETFD, 0);
+	fcntl(peer->livefd, F_SETFD, 0);
+	sprintf(args[0], "shm");
+	sprintf(args[1], "%05d", peer->memfd);
+	sprintf(args[2], "%05d", peer->wfd);
+	sprintf(args[3], "%05d", peer->rfd);
+	sprintf(args[4], "%05d", peer->hupfd);
+	return 5;
+}
+
+int chan_open(struct req_chan *ch, int argc, char *argv[])
+{
+	struct chan_ring *rings;
+
+	ch->tx = ch->rx = NULL;
+	ch->memfd = ch->hupfd = ch->livefd = -1;
+	if (argc == 2) {
+		ch->shm = 0;
+		ch->wfd = atoi(argv[0]);
+		ch->rfd = atoi(argv[1]);
+		return (ch->wfd && ch->rfd) ? 0 : -1;
+	}
+	if (argc != 5 || strcmp(argv[0], "shm") != 0)
+		return -1;
+
+	/* Our livefd came along open: it is only there to be held */
+	ch->shm = 1;
+	ch->wfd = atoi(argv[2]);
+	ch->rfd = atoi(argv[3]);
+	ch->hupfd = atoi(argv[4]);
+	rings = map_rings(atoi(argv[1]));
+	if (rings == NULL)
+		return -1;
+	close(atoi(argv[1]));
+	ch->tx = &rings[0];
+	ch->rx = &rings[1];
+	return 0;
+}
+
+void chan_close(struct req_chan *ch)
+{
+	close(ch->wfd);
+	close(ch->rfd);
+	if (ch->hupfd >= 0)
+		close(ch->hupfd);
+	if (ch->livefd >= 0)
+		close(ch->livefd);
+}
+
+static int pipe_write(int fd, const char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, buf, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int pipe_read(int fd, char *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = read(fd, buf, len);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static uint32_t ring_used(struct chan_ring *r)
+{
+	return atomic_load_explicit(&r->head, memory_order_acquire) -
+	       atomic_load_explicit(&r->tail, memory_order_relaxed);
+}
+
+static int ring_write(struct chan_ring *r, const char *buf, size_t len)
+{
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+	size_t first;
+
+	if (len > CHAN_RING_SIZE - (head - tail)) {
+		errno = ENOSPC;
+		return -1;
+	}
+	first = CHAN_RING_SIZE - (head & RING_MASK);
+	if (first > len)
+		first = len;
+	memcpy(&r->data[head & RING_MASK], buf, first);
+	memcpy(&r->data[0], buf + first, len - first);
+	/* Publish the bytes before the new head */
+	atomic_store_explicit(&r->head, head + len, memory_order_release);
+	return 0;
+}
+
+static void ring_read(struct chan_ring *r, char *buf, size_t len)
+{
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	size_t first = CHAN_RING_SIZE - (tail & RING_MASK);
+
+	if (first > len)
+		first = len;
+	memcpy(buf, &r->data[tail & RING_MASK], first);
+	memcpy(buf + first, &r->data[0], len - first);
+	/* Done with the bytes before handing the space back */
+	atomic_store_explicit(&r->tail, tail + len, memory_order_release);
+}
+
+int chan_send(struct req_chan *ch, const void *buf, size_t len)
+{
+	uint64_t one = 1;
+
+	if (!ch->shm)
+		return pipe_write(ch->wfd, buf, len);
+
+	if (ring_write(ch->tx, buf, len) < 0)
+		return -1;
+	if (write(ch->wfd, &one, sizeof(one)) != sizeof(one))
+		return -1;
+	return 0;
+}
+
+int chan_recv(struct req_chan *ch, void *buf, size_t len)
+{
+	struct pollfd pfd[2] = {
+		{ .fd = ch->rfd, .events = POLLIN },
+		{ .fd = ch->hupfd, .events = POLLIN },
+	};
+	uint64_t cnt;
+
+	if (!ch->shm)
+		return pipe_read(ch->rfd, buf, len);
+
+	while (ring_used(ch->rx) < len) {
+		if (poll(pfd, 2, -1) < 0 && errno != EINTR)
+			return -1;
+		if (read(ch->rfd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN)
+			return -1;
+		/* Nothing is ever written to it: the peer is gone, with what it sent */
+		if (pfd[1].revents && ring_used(ch->rx) < len) {
+			errno = EPIPE;
+			return -1;
+		}
+	}
+	ring_read(ch->rx, buf, len);
+	return 0;
+}
+
+int chan_readable(struct req_chan *ch)
+{
+	uint64_t cnt;
+
+	if (!ch->shm)
+		return 1;
+	if (read(ch->rfd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN)
+		return 0;
+	return ring_used(ch->rx) > 0;
+}
@@ -0,0 +1,79 @@
+#ifndef REQUEST_CHAN_H
+#define REQUEST_CHAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/******************************************************************************
+ * Control channel between the shell and the scheduler.
+ *
+ * Either a pair of pipes, or a pair of single-producer/single-consumer
+ * byte rings in shared memory, one per direction, with an eventfd per
+ * direction to wake up the reader. With the rings a message costs one
+ * eventfd write on the sending side and one read on the receiving side,
+ * and the bytes never go through the kernel. An eventfd doesn't hang up
+ * when the other side dies, as a pipe does, so each side also holds the
+ * write end of a pipe that carries nothing: its read end hangs up when
+ * the holder is gone.
+ *
+ * Messages are only published whole, so a reader that finds a message
+ * header in the ring also finds the rest of it there.
+ */
+
+#define CHAN_RING_SIZE (64 * 1024)   /* bytes of data per ring, a power of two */
+
+struct chan_ring {
+	_Atomic uint32_t head;   /* next byte to write, only moved by the producer */
+	char pad1[60];
+	_Atomic uint32_t tail;   /* next byte to read, only moved by the consumer */
+	char pad2[60];
+	char data[CHAN_RING_SIZE];
+};
+
+struct req_chan {
+	int shm;                 /* rings rather than pipes */
+	int wfd;                 /* pipe to write to, or eventfd to kick the peer with */
+	int rfd;                 /* pipe to read from, or eventfd the peer kicks */
+	struct chan_ring *tx, *rx;
+	int memfd;               /* the rings, for the peer to map after exec() */
+	int hupfd;               /* rings: hangs up once the peer is gone */
+	int livefd;              /* rings: the peer's hupfd, held open while we live */
+};
+
+/*
+ * Set up both ends of a channel. The peer's end is to be passed on
+ * with chan_args() and opened with chan_open().
+ */
+void chan_create(struct req_chan *ours, struct req_chan *peer, int shm);
+
+/*
+ * Format the peer's end as command-line arguments: 2 for pipes, 5 for
+ * rings. Call it in the peer's process, as it keeps the descriptors
+ * open across exec().
+ */
+int chan_args(struct req_chan *peer, char args[5][16]);
+
+/* Open the channel described by argv[], as formatted by chan_args() */
+int chan_open(struct req_chan *ch, int argc, char *argv[]);
+
+/* Close our end of a channel */
+void chan_close(struct req_chan *ch);
+
+/* Send len bytes as one message. Returns 0, or -1 with errno set. */
+int chan_send(struct req_chan *ch, const void *buf, size_t len);
+
+/*
+ * Receive exactly len bytes, waiting for them. Returns 0, or -1 at EOF
+ * (the peer is gone: EPIPE for the rings) or on error.
+ */
+int chan_recv(struct req_chan *ch, void *buf, size_t len);
+
+/*
+ * For the event loop: acknowledge a wakeup on ->rfd.
+ * Returns whether there is a message to read: for a pipe the wakeup
+ * itself says so, for the rings only bytes in the ring do.
+ */
+int chan_readable(struct req_chan *ch);
+
+#endif /* REQUEST_CHAN_H */
@@ -1,6 +1,7 @@
 #ifndef REQUEST_H_
 #define REQUEST_H_
 
+#include <stdint.h>
 #include <unistd.h>
 #include <sys/types.h>
 
@@ -11,10 +12,48 @@ enum request_enum {
 	REQ_EXEC_TASK,    /* execute ->exec_task_arg with priority ->prio_arg */
 	REQ_HIGH_TASK,    /* set ->task_arg to be of high priority */
 	REQ_LOW_TASK,     /* set ->task_arg to be of low priority */
+	REQ_SET_QUANTUM,  /* set the time quantum to ->task_arg ms */
+	REQ_PRINT_STATS,  /* print scheduler statistics */
+	REQ_DUMP_STATS,   /* dump statistics to the file ->exec_task_arg */
+	REQ_BATCH,        /* ->task_arg requests follow, one reply each */
+	REQ_EXEC_ARGV,    /* execute with argv/envp from a ->task_arg byte payload */
+	REQ_SET_TICKETS,  /* give ->task_arg the int number of tickets at ->exec_task_arg */
 };
 
 #define EXEC_TASK_NAME_SZ 60
 
+/*
+ * A batch is a REQ_BATCH header carrying the count in ->task_arg,
+ * followed by that many plain requests in the same write. The scheduler
+ * answers with one int per request, in order, in a single write.
+ * Batches can't nest.
+ */
+#define REQ_BATCH_MAX 256
+
+/*
+ * REQ_EXEC_ARGV is followed by a payload of ->task_arg bytes: an
+ * exec_payload header, then argc strings for argv (argv[0] is also the
+ * program to execute) and envc strings for the environment, each a
+ * uint32_t length followed by that many bytes, without a NUL.
+ * In a batch, the payloads follow all of the batch's requests, in order.
+ *
+ * A task with a deadline (for the edf policy) carries it in the header,
+ * in ms from when the request is processed, together with the CPU time
+ * it is expected to need; the scheduler turns it down with EBUSY if the
+ * deadlines can't all be met with it.
+ */
+struct exec_payload {
+	uint32_t argc;
+	uint32_t envc;
+	uint32_t deadline_ms;  /* 0 for none */
+	uint32_t runtime_ms;
+};
+
+#define REQ_EXEC_PAYLOAD_MAX (16 * 1024)
+
+/* Largest message, of requests and payloads, in either direction */
+#define REQ_FRAME_MAX (64 * 1024)
+
 /* Structure describing system call. */
 struct request_struct {
 	/* System call number */
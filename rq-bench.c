@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "task-list.h"
+#include "task-ring.h"
+
+/*
+ * Run queue microbenchmark.
+ *
+ * Times the operations a round-robin policy does on its queue, with the
+ * nodes' run queue links (rqAppend/rqRemove, as the run queues used to
+ * be) against the ring of task-ring.c, at a number of queue lengths:
+ *
+ *   dispatch : pick the head and send it to the back, once per quantum
+ *   requeue  : take a random task out and put it back at the end, as
+ *              for an exit and a new task, a steal or a priority move
+ *
+ * Tasks are queued in random order, as they end up after some churn,
+ * so that neighbours in the queue aren't neighbours in memory.
+ */
+
+#define RQ_BENCH_OPS 4000000L
+#define RQ_BENCH_MAX_SIZES 16
+
+static unsigned long rng = 88172645463325252UL;
+
+/* xorshift64, the same sequence for both structures */
+static unsigned long next_rand(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng;
+}
+
+static double elapsed_ns(struct timespec *a, struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+static void shuffle(node **v, int n)
+{
+	node *tmp;
+	int i, j;
+
+	for (i = n - 1; i > 0; i--) {
+		j = next_rand() % (i + 1);
+		tmp = v[i];
+		v[i] = v[j];
+		v[j] = tmp;
+	}
+}
+
+/* Returns ns per dispatch and per requeue, and a checksum of the picks */
+static long bench_list(node **tasks, int n, long ops, double *dispatch, double *requeue)
+{
+	struct timespec t0, t1;
+	node *queue = NULL, *t;
+	long i, sum = 0;
+
+	for (i = 0; i < n; i++)
+		rqAppend(&queue, tasks[i]);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ops; i++) {
+		t = queue;
+		sum += t->id;
+		rqRemove(&queue, t);
+		rqAppend(&queue, t);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	*dispatch = elapsed_ns(&t0, &t1) / ops;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ops; i++) {
+		t = tasks[next_rand() % n];
+		rqRemove(&queue, t);
+		rqAppend(&queue, t);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	*requeue = elapsed_ns(&t0, &t1) / ops;
+
+	while (queue != NULL)
+		rqRemove(&queue, queue);
+	return sum;
+}
+
+static long bench_ring(node **tasks, int n, long ops, double *dispatch, double *requeue)
+{
+	struct timespec t0, t1;
+	struct task_ring ring;
+	node *t;
+	long i, sum = 0;
+
+	ring_init(&ring);
+	for (i = 0; i < n; i++)
+		ring_push(&ring, tasks[i]);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ops; i++) {
+		t = ring_head(&ring);
+		sum += t->id;
+		ring_requeue(&ring, t);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	*dispatch = elapsed_ns(&t0, &t1) / ops;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < ops; i++) {
+		t = tasks[next_rand() % n];
+		ring_requeue(&ring, t);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	*requeue = elapsed_ns(&t0, &t1) / ops;
+
+	free(ring.v);
+	return sum;
+}
+
+static void usage(char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-n tasks[,tasks...]] [-o ops]\n", argv0);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	int sizes[RQ_BENCH_MAX_SIZES] = { 10000, 100000 };
+	int nsizes = 2, opt, i, n, max = 0;
+	long ops = RQ_BENCH_OPS, sum_list, sum_ring;
+	double list_dispatch, list_requeue, ring_dispatch, ring_requeue;
+	char *tok;
+	node **tasks;
+
+	while ((opt = getopt(argc, argv, "n:o:")) != -1) {
+		switch (opt) {
+			case 'n':
+				nsizes = 0;
+				for (tok = strtok(optarg, ","); tok != NULL; tok = strtok(NULL, ",")) {
+					if (nsizes == RQ_BENCH_MAX_SIZES || (sizes[nsizes] = atoi(tok)) < 1)
+						usage(argv[0]);
+					nsizes++;
+				}
+				break;
+			case 'o':
+				if ((ops = atol(optarg)) < 1)
+					usage(argv[0]);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (nsizes == 0)
+		usage(argv[0]);
+
+	for (i = 0; i < nsizes; i++)
+		if (sizes[i] > max)
+			max = sizes[i];
+	tasks = malloc(max * sizeof(*tasks));
+	if (tasks == NULL) {
+		perror("malloc");
+		exit(1);
+	}
+	for (i = 0; i < max; i++)
+		tasks[i] = addNode(i + 1, "task");
+
+	printf("%-8s %-10s %12s %12s\n", "queue", "tasks", "dispatch_ns", "requeue_ns");
+	for (i = 0; i < nsizes; i++) {
+		n = sizes[i];
+		shuffle(tasks, n);
+		sum_list = bench_list(tasks, n, ops, &list_dispatch, &list_requeue);
+		sum_ring = bench_ring(tasks, n, ops, &ring_dispatch, &ring_requeue);
+		if (sum_list != sum_ring) {
+			fprintf(stderr, "%s: list and ring picked differently at %d tasks\n",
+				argv[0], n);
+			exit(1);
+		}
+		printf("%-8s %-10d %12.1f %12.1f\n", "list", n, list_dispatch, list_requeue);
+		printf("%-8s %-10d %12.1f %12.1f\n", "ring", n, ring_dispatch, ring_requeue);
+	}
+	return 0;
+}
@@ -0,0 +1,376 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#include "sched-cgroup.h"
+
+/* How long cg_cleanup() waits for killed processes to leave their cgroups */
+#define CG_CLEANUP_TRIES 100
+#define CG_CLEANUP_NSEC 10000000L
+
+static char base_path[2 * PATH_MAX + 32];
+static int base_fd = -1;
+static pid_t owner;
+
+/* Hierarchy in use: cgroup v2, or the v1 cpu controller's for bandwidth */
+static int version;
+
+/* Task cgroups that still had processes when their task exited */
+static int *leftover = NULL;
+static int nleftover = 0, leftover_cap = 0;
+
+/* Is word one of the comma or space separated words of list? */
+static int has_word(const char *list, const char *word)
+{
+	size_t len = strlen(word);
+	const char *p;
+
+	for (p = list; (p = strstr(p, word)) != NULL; p += len)
+		if ((p == list || p[-1] == ',' || p[-1] == ' ') &&
+		    (p[len] == '\0' || p[len] == ',' || p[len] == ' '))
+			return 1;
+	return 0;
+}
+
+/*
+ * Where the hierarchy is mounted, from /proc/self/mounts: cgroup2, or
+ * with controller set the v1 hierarchy that has it among its options.
+ */
+static int find_mount(const char *controller, char *mnt, size_t len)
+{
+	char dev[64], dir[PATH_MAX], type[64], opts[256];
+	FILE *fp = fopen("/proc/self/mounts", "r");
+	int ret = -ENOENT;
+
+	if (fp == NULL)
+		return -errno;
+	while (fscanf(fp, "%63s %4095s %63s %255s %*[^\n]", dev, dir, type, opts) == 4) {
+		if (controller == NULL ? strcmp(type, "cgroup2") == 0 :
+		    strcmp(type, "cgroup") == 0 && has_word(opts, controller)) {
+			snprintf(mnt, len, "%s", dir);
+			ret = 0;
+			break;
+		}
+	}
+	fclose(fp);
+	return ret;
+}
+
+/*
+ * Our own cgroup path, from /proc/self/cgroup: the "0::" line for v2,
+ * with controller the line of the v1 hierarchy that has it.
+ */
+static int find_own_cgroup(const char *controller, char *path, size_t len)
+{
+	char line[PATH_MAX + 256], *ctrls, *own;
+	FILE *fp = fopen("/proc/self/cgroup", "r");
+	int ret = -ENOENT;
+
+	if (fp == NULL)
+		return -errno;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\n")] = '\0';
+		/* hierarchy-id:controller,...:path */
+		ctrls = strchr(line, ':');
+		own = (ctrls != NULL) ? strchr(ctrls + 1, ':') : NULL;
+		if (own == NULL)
+			continue;
+		*ctrls++ = '\0';
+		*own++ = '\0';
+		if (controller == NULL ? strcmp(line, "0") != 0 || ctrls[0] != '\0' :
+		    !has_word(ctrls, controller))
+			continue;
+		if (strlen(own) >= len) {
+			ret = -ENAMETOOLONG;
+			break;
+		}
+		strcpy(path, own);
+		ret = 0;
+		break;
+	}
+	fclose(fp);
+	return ret;
+}
+
+static int write_at(int dirfd, const char *file, const char *val)
+{
+	int fd = openat(dirfd, file, O_WRONLY | O_CLOEXEC);
+	ssize_t n;
+
+	if (fd < 0)
+		return -errno;
+	n = write(fd, val, strlen(val));
+	close(fd);
+	return (n < 0) ? -errno : 0;
+}
+
+/* Does the cgroup v2 directory at dirfd offer the cpu controller? */
+static int v2_has_cpu(int dirfd)
+{
+	char buf[256];
+	ssize_t n;
+	int fd = openat(dirfd, "cgroup.controllers", O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return 0;
+	n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (n <= 0)
+		return 0;
+	buf[n] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return has_word(buf, "cpu");
+}
+
+/* Create sched-<pid> below our cgroup in the hierarchy mounted at mnt. */
+static int make_base(const char *controller, const char *mnt)
+{
+	char own[PATH_MAX];
+	int ret;
+
+	if ((ret = find_own_cgroup(controller, own, sizeof(own))) < 0)
+		return ret;
+	snprintf(base_path, sizeof(base_path), "%s%s/sched-%ld",
+		 mnt, strcmp(own, "/") ? own : "", (long)getpid());
+	if (mkdir(base_path, 0755) < 0)
+		return -errno;
+	base_fd = open(base_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (base_fd < 0) {
+		ret = -errno;
+		rmdir(base_path);
+		return ret;
+	}
+	return 0;
+}
+
+/*
+ * The cpu controller in cgroup v2: it has to be enabled for the
+ * children of our cgroup and of sched-<pid>. The former fails if our
+ * cgroup has processes and isn't the root, and then v1 is tried.
+ */
+static int init_v2_cpu(const char *mnt)
+{
+	int ret;
+
+	if ((ret = make_base(NULL, mnt)) < 0)
+		return ret;
+	if (!v2_has_cpu(base_fd)) {
+		(void)write_at(base_fd, "../cgroup.subtree_control", "+cpu");
+		if (!v2_has_cpu(base_fd)) {
+			ret = -ENOTSUP;
+			goto fail;
+		}
+	}
+	if ((ret = write_at(base_fd, "cgroup.subtree_control", "+cpu")) < 0)
+		goto fail;
+	return 0;
+
+fail:
+	close(base_fd);
+	base_fd = -1;
+	rmdir(base_path);
+	return ret;
+}
+
+int cg_init(int cpu)
+{
+	char mnt[PATH_MAX];
+	int ret;
+
+	ret = find_mount(NULL, mnt, sizeof(mnt));
+	if (!cpu) {
+		if (ret < 0 || (ret = make_base(NULL, mnt)) < 0)
+			return ret;
+		version = 2;
+	} else if (ret == 0 && (ret = init_v2_cpu(mnt)) == 0) {
+		version = 2;
+	} else {
+		/* No cpu controller in v2 here: the v1 one does the same */
+		if ((ret = find_mount("cpu", mnt, sizeof(mnt))) < 0 ||
+		    (ret = make_base("cpu", mnt)) < 0)
+			return ret;
+		version = 1;
+	}
+
+	/* Also on the exit()s for fatal errors */
+	owner = getpid();
+	atexit(cg_cleanup);
+	return 0;
+}
+
+int cg_version(void)
+{
+	return version;
+}
+
+int cg_task_attach(node *t)
+{
+	char name[32], pid[16];
+	int ret;
+
+	snprintf(name, sizeof(name), "task-%d", t->id);
+	if (mkdirat(base_fd, name, 0755) < 0)
+		return -errno;
+	t->cg_dir = openat(base_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (t->cg_dir < 0)
+		goto fail;
+	/* Kept open: freezing and thawing is then a single write */
+	if (version == 2) {
+		t->cg_freeze = openat(t->cg_dir, "cgroup.freeze", O_WRONLY | O_CLOEXEC);
+		if (t->cg_freeze < 0)
+			goto fail;
+	}
+
+	snprintf(pid, sizeof(pid), "%ld", (long)t->pid);
+	if ((ret = write_at(t->cg_dir, "cgroup.procs", pid)) < 0) {
+		errno = -ret;
+		goto fail;
+	}
+	return 0;
+
+fail:
+	ret = -errno;
+	if (t->cg_freeze >= 0)
+		close(t->cg_freeze);
+	if (t->cg_dir >= 0)
+		close(t->cg_dir);
+	t->cg_dir = t->cg_freeze = -1;
+	unlinkat(base_fd, name, AT_REMOVEDIR);
+	return ret;
+}
+
+int cg_freeze(node *t, int frozen)
+{
+	if (pwrite(t->cg_freeze, frozen ? "1" : "0", 1, 0) < 0)
+		return -errno;
+	return 0;
+}
+
+/*
+ * v1 has no cgroup.kill: signal the processes listed in the cgroup.
+ * One that forks meanwhile can escape, which cgroup.kill prevents.
+ */
+static int kill_procs(int dirfd)
+{
+	FILE *fp;
+	long pid;
+	int fd;
+
+	fd = openat(dirfd, "cgroup.procs", O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+	fp = fdopen(fd, "r");
+	if (fp == NULL) {
+		close(fd);
+		return -errno;
+	}
+	while (fscanf(fp, "%ld", &pid) == 1)
+		kill((pid_t)pid, SIGKILL);
+	fclose(fp);
+	return 0;
+}
+
+int cg_kill(node *t)
+{
+	if (version == 1)
+		return kill_procs(t->cg_dir);
+	return write_at(t->cg_dir, "cgroup.kill", "1");
+}
+
+int cg_set_weight(node *t, int weight)
+{
+	char val[16];
+
+	if (version == 1) {
+		/* cpu.shares is 1024 where cpu.weight is 100 */
+		snprintf(val, sizeof(val), "%d", weight * 1024 / CG_WEIGHT_DEFAULT);
+		return write_at(t->cg_dir, "cpu.shares", val);
+	}
+	snprintf(val, sizeof(val), "%d", weight);
+	return write_at(t->cg_dir, "cpu.weight", val);
+}
+
+int cg_set_max(node *t, long quota_us, long period_us)
+{
+	char val[48];
+	int ret;
+
+	if (version == 1) {
+		snprintf(val, sizeof(val), "%ld", period_us);
+		if ((ret = write_at(t->cg_dir, "cpu.cfs_period_us", val)) < 0)
+			return ret;
+		snprintf(val, sizeof(val), "%ld", quota_us > 0 ? quota_us : -1);
+		return write_at(t->cg_dir, "cpu.cfs_quota_us", val);
+	}
+	if (quota_us > 0)
+		snprintf(val, sizeof(val), "%ld %ld", quota_us, period_us);
+	else
+		snprintf(val, sizeof(val), "max %ld", period_us);
+	return write_at(t->cg_dir, "cpu.max", val);
+}
+
+void cg_task_release(node *t)
+{
+	char name[32];
+
+	if (t->cg_dir < 0)
+		return;
+
+	/* Whatever the task left behind goes with it */
+	cg_kill(t);
+	if (t->cg_freeze >= 0)
+		close(t->cg_freeze);
+	close(t->cg_dir);
+	t->cg_dir = t->cg_freeze = -1;
+
+	snprintf(name, sizeof(name), "task-%d", t->id);
+	if (unlinkat(base_fd, name, AT_REMOVEDIR) == 0 || errno != EBUSY)
+		return;
+
+	/* Still populated until the killed processes are gone: retry at exit */
+	if (nleftover == leftover_cap) {
+		leftover_cap = leftover_cap ? 2 * leftover_cap : 16;
+		leftover = realloc(leftover, leftover_cap * sizeof(*leftover));
+		if (leftover == NULL) {
+			perror("realloc");
+			exit(1);
+		}
+	}
+	leftover[nleftover++] = t->id;
+}
+
+void cg_cleanup(void)
+{
+	struct timespec nap = { 0, CG_CLEANUP_NSEC };
+	char name[32];
+	int i, tries;
+
+	/* Not in forked children that exit() */
+	if (base_fd < 0 || getpid() != owner)
+		return;
+
+	for (tries = 0; nleftover > 0 && tries < CG_CLEANUP_TRIES; tries++) {
+		for (i = 0; i < nleftover; i++) {
+			snprintf(name, sizeof(name), "task-%d", leftover[i]);
+			if (unlinkat(base_fd, name, AT_REMOVEDIR) == 0 || errno != EBUSY)
+				leftover[i--] = leftover[--nleftover];
+		}
+		if (nleftover > 0)
+			nanosleep(&nap, NULL);
+	}
+
+	close(base_fd);
+	base_fd = -1;
+	if (rmdir(base_path) < 0)
+		fprintf(stderr, "Scheduler: can't remove cgroup %s: %s\n",
+			base_path, strerror(errno));
+}
@@ -0,0 +1,57 @@
+#ifndef SCHED_CGROUP_H
+#define SCHED_CGROUP_H
+
+#include "task-list.h"
+
+/******************************************************************************
+ * cgroup task control.
+ *
+ * The scheduler makes a cgroup of its own, sched-<pid>, below the one it
+ * runs in, and every task gets a cgroup task-<id> in there. A task is
+ * then stopped and continued by writing its cgroup.freeze, which
+ * freezes every process of the task, children included, and needs no
+ * stop notification to take effect.
+ *
+ * For the bandwidth backend the cgroups need the cpu controller instead,
+ * whose cpu.weight and cpu.max share out the CPU between tasks that all
+ * run at once. Where cgroup v2 doesn't offer it, the v1 cpu hierarchy
+ * is used, with cpu.shares and cpu.cfs_quota_us to the same effect;
+ * there is no freezer then.
+ *
+ * Functions return 0 or -errno.
+ */
+
+/* cpu.weight of a task nobody asked for anything for */
+#define CG_WEIGHT_DEFAULT 100
+
+/*
+ * Find the cgroup hierarchy and create the scheduler's cgroup:
+ * one with the cpu controller if cpu is set, else cgroup v2.
+ */
+int cg_init(int cpu);
+
+/* The cgroup version cg_init() settled on, 0 before it succeeded */
+int cg_version(void);
+
+/* Create a cgroup for t and move its process into it. */
+int cg_task_attach(node *t);
+
+/* Freeze (frozen = 1) or thaw (frozen = 0) all of t's processes. */
+int cg_freeze(node *t, int frozen);
+
+/* SIGKILL every process in t's cgroup. */
+int cg_kill(node *t);
+
+/* Set t's share of the CPU, relative to CG_WEIGHT_DEFAULT. */
+int cg_set_weight(node *t, int weight);
+
+/* Cap t at quota_us of CPU time per period_us, quota_us <= 0 for no cap. */
+int cg_set_max(node *t, long quota_us, long period_us);
+
+/* t has exited: kill what is left of it and remove its cgroup. */
+void cg_task_release(node *t);
+
+/* Remove the scheduler's cgroup; cg_init() arranges for it at exit. */
+void cg_cleanup(void);
+
+#endif /* SCHED_CGROUP_H */
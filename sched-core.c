@@ -0,0 +1,1104 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+
+#include <sys/wait.h>
+#include <sys/ptrace.h>
+#include <sys/types.h>
+#include <sys/pidfd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "proc-common.h"
+#include "sched-core.h"
+#include "sched-stats.h"
+#include "sched-cgroup.h"
+#include "sched-trace.h"
+
+/* Compile-time parameters. */
+#define SCHED_TQ_MSEC 2000            /* default time quantum (ms) */
+#define SCHED_SHOW_SZ 64              /* policy column of the task listing */
+#define SCHED_MAX_EVENTS 16           /* events handled per epoll_wait() */
+#define SCHED_WEIGHT_HIGH 400         /* bandwidth: cpu.weight of h tasks */
+#define SCHED_WEIGHT_LOW 25           /* bandwidth: cpu.weight of l tasks */
+#define SCHED_MAX_WEIGHT 10000        /* bandwidth: largest cpu.weight */
+#define SCHED_CPU_PERIOD_US 100000    /* bandwidth: cpu.max period */
+
+struct sched_cpu cpus[SCHED_MAX_CPUS];
+int sched_ncpus = 1;
+volatile int nproc = 0;
+struct sched_policy *policy = &rr_policy;
+int sched_verbose = 0;
+char *sched_stats_path = NULL;
+char *sched_trace_path = NULL;
+const char *sched_extra_opts = "";
+const char *sched_extra_usage = "";
+int (*sched_extra_opt)(int opt, char *arg) = NULL;
+int sched_launcher = SCHED_LAUNCH_VFORK;
+int sched_backend = SCHED_BACKEND_SIGNAL;
+int sched_cpu_max_pct = 0;
+
+/* When the first task was launched, for the startup time */
+static long long launch_begin_ns = -1;
+static int startup_reported = 0, first_dispatched = 0;
+
+/*
+ * Tasks launched but not stopped and ready yet, linked through their
+ * run queue links, as they aren't on a run queue.
+ */
+static node *starting = NULL;
+static int nstarting = 0;
+
+/* Set once the first tasks have been dispatched */
+static int sched_started = 0;
+
+/* Set once the event loop runs, so all initial tasks have been launched */
+static int sched_running = 0;
+
+/* The event loop: every timer, SIGCHLD and the shell are epoll sources */
+static int epoll_fd = -1;
+static struct sched_source sigchld_src;
+
+/* Time quantum in milliseconds, set with -q or the shell's t command */
+long sched_tq_msec = SCHED_TQ_MSEC;
+
+long long policy_now_ns(void)
+{
+	return now_ns();
+}
+
+/*
+ * Set up one dispatch slot per CPU. Slot c is pinned to the c-th CPU
+ * we are allowed to run on.
+ */
+static void sched_init_cpus(void)
+{
+	cpu_set_t allowed;
+	int ids[CPU_SETSIZE];
+	int c, cpu, n = 0;
+
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+		perror("sched_getaffinity");
+		exit(1);
+	}
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &allowed))
+			ids[n++] = cpu;
+	if (sched_ncpus > n)
+		fprintf(stderr, "Scheduler: %d slots on %d CPUs, some CPUs get more than one\n",
+			sched_ncpus, n);
+
+	for (c = 0; c < sched_ncpus; c++) {
+		cpus[c].cpu = ids[c % n];
+		cpus[c].current = NULL;
+		cpus[c].rq.cpu = c;
+		cpus[c].rq.nr = 0;
+		cpus[c].steals = 0;
+		cpus[c].stolen = 0;
+		policy->init(&cpus[c].rq);
+	}
+}
+
+static void usage(char *argv0)
+{
+	int i;
+
+	fprintf(stderr, "Usage: %s [-q quantum_ms] [-p policy] [-c ncpus] [-m mlfq_levels] [-b boost_ms] [-s stats_file] [-S max_exited] [-t trace_file] [-l fork|vfork] [-B signal|freezer|bandwidth] [-M max_cpu_pct]%s prog...\n",
+		argv0, sched_extra_usage);
+	fprintf(stderr, "Policies:");
+	for (i = 0; sched_policies[i] != NULL; i++)
+		fprintf(stderr, " %s", sched_policies[i]->name);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+int sched_parse_args(int argc, char *argv[], struct sched_policy *default_policy)
+{
+	char optstring[64];
+	int opt, ret;
+
+	policy = default_policy;
+	snprintf(optstring, sizeof(optstring), "+q:p:c:m:b:s:S:t:l:B:M:%s", sched_extra_opts);
+	while ((opt = getopt(argc, argv, optstring)) != -1) {
+		switch (opt) {
+			case 'q':
+				if (sched_set_quantum(atoi(optarg)) < 0) {
+					fprintf(stderr, "Scheduler: time quantum must be positive\n");
+					exit(1);
+				}
+				break;
+			case 'p':
+				policy = find_policy(optarg);
+				if (policy == NULL) {
+					fprintf(stderr, "Scheduler: unknown policy `%s'\n", optarg);
+					usage(argv[0]);
+				}
+				break;
+			case 'c':
+				sched_ncpus = atoi(optarg);
+				if (sched_ncpus < 1 || sched_ncpus > SCHED_MAX_CPUS) {
+					fprintf(stderr, "Scheduler: number of CPUs must be between 1 and %d\n",
+						SCHED_MAX_CPUS);
+					exit(1);
+				}
+				break;
+			case 'm':
+				/* -m implies the MLFQ policy */
+				mlfq_levels = atoi(optarg);
+				if (mlfq_levels < 1 || mlfq_levels > MLFQ_MAX_LEVELS) {
+					fprintf(stderr, "Scheduler: MLFQ levels must be between 1 and %d\n",
+						MLFQ_MAX_LEVELS);
+					exit(1);
+				}
+				policy = &mlfq_policy;
+				break;
+			case 'b':
+				mlfq_boost_msec = atol(optarg);
+				if (mlfq_boost_msec <= 0) {
+					fprintf(stderr, "Scheduler: boost period must be positive\n");
+					exit(1);
+				}
+				break;
+			case 's':
+				sched_stats_path = optarg;
+				break;
+			case 'S':
+				stats_exited_max = atol(optarg);
+				if (stats_exited_max < 1) {
+					fprintf(stderr, "Scheduler: number of exited tasks kept must be positive\n");
+					exit(1);
+				}
+				break;
+			case 't':
+				sched_trace_path = optarg;
+				break;
+			case 'l':
+				if (strcmp(optarg, "fork") == 0)
+					sched_launcher = SCHED_LAUNCH_FORK;
+				else if (strcmp(optarg, "vfork") == 0)
+					sched_launcher = SCHED_LAUNCH_VFORK;
+				else
+					usage(argv[0]);
+				break;
+			case 'B':
+				if (strcmp(optarg, "signal") == 0)
+					sched_backend = SCHED_BACKEND_SIGNAL;
+				else if (strcmp(optarg, "freezer") == 0)
+					sched_backend = SCHED_BACKEND_FREEZER;
+				else if (strcmp(optarg, "bandwidth") == 0)
+					sched_backend = SCHED_BACKEND_BANDWIDTH;
+				else
+					usage(argv[0]);
+				break;
+			case 'M':
+				sched_cpu_max_pct = atoi(optarg);
+				if (sched_cpu_max_pct <= 0) {
+					fprintf(stderr, "Scheduler: CPU cap must be a positive percentage\n");
+					exit(1);
+				}
+				break;
+			case '?':
+				usage(argv[0]);
+			default:
+				if (sched_extra_opt == NULL || sched_extra_opt(opt, optarg) < 0)
+					usage(argv[0]);
+		}
+	}
+
+	if (sched_backend == SCHED_BACKEND_FREEZER && (ret = cg_init(0)) < 0) {
+		fprintf(stderr, "Scheduler: no cgroup freezer (%s), using signals\n",
+			strerror(-ret));
+		sched_backend = SCHED_BACKEND_SIGNAL;
+	}
+	if (sched_backend == SCHED_BACKEND_BANDWIDTH && (ret = cg_init(1)) < 0) {
+		fprintf(stderr, "Scheduler: no cgroup cpu controller (%s), using signals\n",
+			strerror(-ret));
+		sched_backend = SCHED_BACKEND_SIGNAL;
+	}
+	sched_init_cpus();
+	if (sched_trace_path != NULL &&
+	    (ret = trace_open(sched_trace_path, TRACE_RECORDS, policy->name,
+			      sched_ncpus, sched_tq_msec)) < 0) {
+		fprintf(stderr, "Scheduler: %s: %s\n", sched_trace_path, strerror(-ret));
+		exit(1);
+	}
+	return optind;
+}
+
+int sched_set_quantum(int msec)
+{
+	if (msec <= 0)
+		return -EINVAL;
+	sched_tq_msec = msec;
+	return 0;
+}
+
+/* CPU time consumed by a task in ns, or -1 if it can't be read */
+static long long task_cpu_time(pid_t pid)
+{
+	clockid_t cid;
+	struct timespec ts;
+
+	if (clock_getcpuclockid(pid, &cid) != 0 || clock_gettime(cid, &ts) < 0)
+		return -1;
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long sched_quantum(node *t)
+{
+	return policy->quantum ? policy->quantum(t) : sched_tq_msec;
+}
+
+/* Arm (msec > 0) or disarm (msec == 0) the quantum timer of a slot. */
+static void sched_arm_timer(struct sched_cpu *sc, long msec)
+{
+	struct itimerspec it;
+
+	it.it_interval.tv_sec = 0;
+	it.it_interval.tv_nsec = 0;
+	it.it_value.tv_sec = msec / 1000;
+	it.it_value.tv_nsec = (msec % 1000) * 1000000;
+	if (timerfd_settime(sc->timer_src.fd, 0, &it, NULL) < 0) {
+		perror("timerfd_settime");
+		exit(1);
+	}
+	sc->deadline_ns = msec ? now_ns() + msec * 1000000LL : 0;
+}
+
+/*
+ * Put a task on a slot's run queue and pin it to the slot's CPU.
+ * Bandwidth tasks aren't pinned: the kernel places them.
+ */
+static void sched_enqueue(struct sched_cpu *sc, node *t)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(sc->cpu, &set);
+	if (sched_backend != SCHED_BACKEND_BANDWIDTH &&
+	    sched_setaffinity(t->pid, sizeof(set), &set) < 0)
+		perror("sched_setaffinity");
+
+	t->cpu = sc->rq.cpu;
+	policy->enqueue(&sc->rq, t);
+	sc->rq.nr++;
+}
+
+/*
+ * Work stealing: a slot that is idle, or at least two tasks shorter
+ * than the busiest one, pulls a waiting task from it before picking.
+ * Every slot balances itself this way at each dispatch, so no central
+ * rebalance is needed.
+ */
+static void sched_steal(struct sched_cpu *sc)
+{
+	struct sched_cpu *victim = NULL;
+	node *t;
+	int c;
+
+	if (policy->steal == NULL)
+		return;
+	for (c = 0; c < sched_ncpus; c++)
+		if (&cpus[c] != sc && (victim == NULL || cpus[c].rq.nr > victim->rq.nr))
+			victim = &cpus[c];
+	if (victim == NULL || (sc->rq.nr > 0 && victim->rq.nr - sc->rq.nr <= 1))
+		return;
+
+	t = policy->steal(&victim->rq, victim->current);
+	if (t == NULL)
+		return;
+	policy->dequeue(&victim->rq, t);
+	victim->rq.nr--;
+	victim->stolen++;
+	sched_enqueue(sc, t);
+	sc->steals++;
+	trace_event(TRACE_STEAL, sc->rq.cpu, t->id, t->pid, victim->rq.cpu, 0);
+}
+
+/* Continue the policy's pick for a slot and give it a quantum. */
+static void sched_dispatch(struct sched_cpu *sc)
+{
+	long long latency_ns;
+	int ret;
+
+	/* Bandwidth tasks are never stopped, so there is nothing to switch to */
+	if (sched_backend == SCHED_BACKEND_BANDWIDTH)
+		return;
+
+	sched_steal(sc);
+	sc->current = policy->pick_next(&sc->rq);
+	if (sc->current == NULL) {
+		sc->expired_ns = 0;
+		sched_arm_timer(sc, 0);
+		return;
+	}
+
+	sc->current->cpu_mark = task_cpu_time(sc->current->pid);
+	if (sched_backend == SCHED_BACKEND_FREEZER) {
+		if ((ret = cg_freeze(sc->current, 0)) < 0)
+			fprintf(stderr, "Scheduler: thaw %s: %s\n", sc->current->name,
+				strerror(-ret));
+	} else if (pidfd_send_signal(sc->current->pidfd.fd, SIGCONT, NULL, 0) < 0)
+		perror("pidfd_send_signal");
+	latency_ns = sc->expired_ns ? now_ns() - sc->expired_ns : -1;
+	stats_dispatched(sc->current, latency_ns);
+	trace_event(TRACE_DISPATCH, sc->rq.cpu, sc->current->id, sc->current->pid, 0,
+		    latency_ns);
+	if (!first_dispatched && launch_begin_ns >= 0) {
+		stats_first_dispatch(now_ns() - launch_begin_ns);
+		first_dispatched = 1;
+	}
+	sc->expired_ns = 0;
+	sched_arm_timer(sc, sched_quantum(sc->current));
+}
+
+/* The slot with the fewest tasks */
+static struct sched_cpu *sched_least_loaded(void)
+{
+	int c, best = 0;
+
+	for (c = 1; c < sched_ncpus; c++)
+		if (cpus[c].rq.nr < cpus[best].rq.nr)
+			best = c;
+	return &cpus[best];
+}
+
+/* Turn a waitid() result back into a wait() status for explain_wait_status() */
+static int wait_status(siginfo_t *info)
+{
+	if (info->si_code == CLD_EXITED)
+		return W_EXITCODE(info->si_status, 0);
+	if (info->si_code == CLD_STOPPED)
+		return W_STOPCODE(info->si_status);
+	return W_EXITCODE(0, info->si_status);
+}
+
+static void sched_task_exited(struct sched_source *src);
+static void sched_preempt(struct sched_cpu *sc);
+
+/*
+ * Once the event loop runs and no initial task is still starting,
+ * report how long the startup took.
+ */
+static void sched_check_startup(void)
+{
+	long long ns;
+
+	if (startup_reported || !sched_running || nstarting > 0 ||
+	    launch_begin_ns < 0)
+		return;
+	ns = now_ns() - launch_begin_ns;
+	stats_started(ns);
+	startup_reported = 1;
+	if (sched_verbose)
+		fprintf(stderr, "Scheduler: %d tasks ready in %lld us (%s)\n",
+			nproc, ns / 1000,
+			sched_launcher == SCHED_LAUNCH_VFORK ? "vfork" : "fork");
+}
+
+/* A task has stopped, ready to run: give it to the least loaded slot. */
+static void sched_task_ready(node *t)
+{
+	struct sched_cpu *sc = sched_least_loaded();
+	int ret;
+
+	/*
+	 * With the freezer the task is held frozen in its cgroup instead:
+	 * continue it, it only runs once its cgroup is thawed.
+	 */
+	if (sched_backend == SCHED_BACKEND_FREEZER) {
+		if ((ret = cg_task_attach(t)) < 0 || (ret = cg_freeze(t, 1)) < 0) {
+			fprintf(stderr, "Scheduler: cgroup for %s: %s\n", t->name,
+				strerror(-ret));
+			exit(1);
+		}
+		if (pidfd_send_signal(t->pidfd.fd, SIGCONT, NULL, 0) < 0)
+			perror("pidfd_send_signal");
+	}
+
+	/*
+	 * With bandwidth it runs from now on, for as long as it likes. It
+	 * still goes on a run queue, where the policy merely keeps it.
+	 */
+	if (sched_backend == SCHED_BACKEND_BANDWIDTH) {
+		if ((ret = cg_task_attach(t)) < 0 ||
+		    (ret = cg_set_weight(t, t->cg_weight)) < 0 ||
+		    (ret = cg_set_max(t, sched_cpu_max_pct * (SCHED_CPU_PERIOD_US / 100),
+				      SCHED_CPU_PERIOD_US)) < 0) {
+			fprintf(stderr, "Scheduler: cgroup for %s: %s\n", t->name,
+				strerror(-ret));
+			exit(1);
+		}
+		if (pidfd_send_signal(t->pidfd.fd, SIGCONT, NULL, 0) < 0)
+			perror("pidfd_send_signal");
+		stats_dispatched(t, -1);
+		trace_event(TRACE_DISPATCH, sc->rq.cpu, t->id, t->pid, 0, -1);
+		if (!first_dispatched && launch_begin_ns >= 0) {
+			stats_first_dispatch(now_ns() - launch_begin_ns);
+			first_dispatched = 1;
+		}
+	}
+
+	sched_enqueue(sc, t);
+	trace_event(TRACE_READY, sc->rq.cpu, t->id, t->pid, 0, 0);
+	if (t->prio_pending && policy->set_priority != NULL &&
+	    sched_backend != SCHED_BACKEND_BANDWIDTH)
+		policy->set_priority(&sc->rq, t, t->prio_pending - 1);
+	t->prio_pending = 0;
+	if (sched_started && sc->current == NULL)
+		sched_dispatch(sc);
+	else if (sched_started && policy->preempts != NULL &&
+		 policy->preempts(&sc->rq, t, sc->current))
+		sched_preempt(sc);
+}
+
+/* Find the starting tasks that have stopped, and make them ready. */
+static void sched_check_starting(void)
+{
+	node *t, *next;
+	siginfo_t info;
+	int n;
+
+	for (t = starting, n = nstarting; n > 0; t = next, n--) {
+		next = t->rq_next;
+		info.si_pid = 0;
+		if (waitid(P_PIDFD, t->pidfd.fd, &info, WSTOPPED | WNOHANG) < 0) {
+			/* ECHILD: it has exited, its pidfd will tell us */
+			if (errno == ECHILD)
+				continue;
+			perror("waitid");
+			exit(1);
+		}
+		if (info.si_pid == 0)
+			continue;
+
+		if (sched_verbose)
+			explain_wait_status(info.si_pid, wait_status(&info));
+		rqRemove(&starting, t);
+		nstarting--;
+		sched_task_ready(t);
+	}
+	sched_check_startup();
+}
+
+/* Create the node of a task and watch its pidfd. */
+static node *sched_new_task(pid_t pid, char *name)
+{
+	node *t = addNode(pid, name);
+
+	t->cg_dir = t->cg_freeze = -1;
+	t->cg_weight = CG_WEIGHT_DEFAULT;
+	/* We haven't reaped the child yet, so pid can't have been reused */
+	t->pidfd.fd = pidfd_open(pid, 0);
+	if (t->pidfd.fd < 0) {
+		perror("pidfd_open");
+		exit(1);
+	}
+	t->pidfd.handle = sched_task_exited;
+	t->pidfd.arg = t;
+	sched_watch(&t->pidfd);
+	stats_task_created(t);
+	trace_create(t->id, pid, name);
+	nproc++;
+	return t;
+}
+
+/* A new task is ready to run, or will be once it has stopped. */
+static void sched_launched(node *t, int ready)
+{
+	if (ready) {
+		sched_task_ready(t);
+	} else {
+		/* Not on any slot until its stop is reported */
+		t->cpu = -1;
+		rqAppend(&starting, t);
+		nstarting++;
+	}
+}
+
+node* sched_add_task(pid_t pid, char *name, int ready)
+{
+	node *t = sched_new_task(pid, name);
+
+	sched_launched(t, ready);
+	return t;
+}
+
+/*
+ * The detach only queues the SIGSTOP: the child takes it when it next
+ * runs, which could be after a SIGCONT that is then lost. Wait for the
+ * stop, leaving an exit to be reaped through the pidfd.
+ */
+static void spawn_wait_stopped(pid_t pid)
+{
+	siginfo_t info;
+
+	while (waitid(P_PID, pid, &info, WSTOPPED | WEXITED | WNOWAIT) < 0) {
+		if (errno != EINTR) {
+			perror("waitid");
+			exit(1);
+		}
+	}
+	if (info.si_code == CLD_STOPPED &&
+	    waitid(P_PID, pid, &info, WSTOPPED | WNOHANG) < 0) {
+		perror("waitid");
+		exit(1);
+	}
+}
+
+/*
+ * Launch a task without copying our address space: the vfork()ed child
+ * asks to be traced and execs, which stops it with SIGTRAP before the
+ * new program runs its first instruction. We then detach with SIGSTOP
+ * and wait for the stop, so it stays stopped, as a forked task that
+ * raised SIGSTOP would.
+ *
+ * Returns the pid, -1 with errno set if the exec failed, or 0 if
+ * tracing isn't allowed here and the caller should fork() instead.
+ */
+static pid_t spawn_vfork(char *const argv[], char *const envp[])
+{
+	/* The child shares our memory until it execs: it reports failure here */
+	volatile int child_errno = 0, no_ptrace = 0;
+	int status;
+	pid_t pid;
+
+	pid = vfork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0) {
+		/* System calls only, nothing that touches shared state */
+		if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0) {
+			no_ptrace = 1;
+			_exit(127);
+		}
+		sched_child_reset_signals();
+		execve(argv[0], argv, envp);
+		child_errno = errno;
+		_exit(127);
+	}
+
+	if (waitpid(pid, &status, __WALL) < 0) {
+		perror("waitpid");
+		exit(1);
+	}
+	if (WIFSTOPPED(status) && WSTOPSIG(status) == SIGTRAP) {
+		if (ptrace(PTRACE_DETACH, pid, NULL, (void *)(long)SIGSTOP) < 0) {
+			perror("ptrace(PTRACE_DETACH)");
+			exit(1);
+		}
+		spawn_wait_stopped(pid);
+		return pid;
+	}
+	if (no_ptrace) {
+		fprintf(stderr, "Scheduler: can't trace tasks, launching with fork()\n");
+		return 0;
+	}
+	errno = child_errno ? child_errno : ECHILD;
+	return -1;
+}
+
+static pid_t spawn_fork(char *const argv[], char *const envp[])
+{
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+	} else if (pid == 0) {
+		sched_child_reset_signals();
+		raise(SIGSTOP);
+		execve(argv[0], argv, envp);
+		// Unreachable point. Execve only returns on error.
+		perror("execve");
+		exit(1);
+	}
+	return pid;
+}
+
+/* Launch a task; deadline_ns and runtime_ns as for sched_spawn_deadline() */
+static pid_t spawn_task(char *const argv[], char *const envp[],
+			long long deadline_ns, long long runtime_ns)
+{
+	long long begin = now_ns();
+	node *t;
+	pid_t pid = 0;
+
+	if (launch_begin_ns < 0)
+		launch_begin_ns = begin;
+
+	if (sched_launcher == SCHED_LAUNCH_VFORK) {
+		pid = spawn_vfork(argv, envp);
+		if (pid < 0) {
+			int err = errno;
+
+			fprintf(stderr, "Scheduler: can't execute %s: %s\n",
+				argv[0], strerror(err));
+			errno = err;
+			return -1;
+		}
+		if (pid == 0)
+			sched_launcher = SCHED_LAUNCH_FORK;
+	}
+	if (pid == 0)
+		pid = spawn_fork(argv, envp);
+	if (pid < 0)
+		return -1;
+
+	stats_spawned(now_ns() - begin);
+	/* Before it goes on a run queue, where the policy looks at them */
+	t = sched_new_task(pid, argv[0]);
+	t->deadline_ns = deadline_ns;
+	t->runtime_ns = runtime_ns;
+	/* A vfork()ed task has stopped already, a fork()ed one stops itself */
+	sched_launched(t, sched_launcher == SCHED_LAUNCH_VFORK);
+	return pid;
+}
+
+pid_t sched_spawn_task(char *const argv[], char *const envp[])
+{
+	return spawn_task(argv, envp, 0, 0);
+}
+
+pid_t sched_spawn_deadline(char *const argv[], char *const envp[],
+			   long deadline_ms, long runtime_ms)
+{
+	long long now = now_ns(), deadline_ns, runtime_ns;
+	int ret;
+
+	if (policy->admit == NULL) {
+		fprintf(stderr, "Scheduler: the %s policy has no deadlines\n",
+			policy->name);
+		errno = ENOTSUP;
+		return -1;
+	}
+	if (deadline_ms <= 0 || runtime_ms < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	deadline_ns = now + deadline_ms * 1000000LL;
+	runtime_ns = runtime_ms * 1000000LL;
+	if ((ret = policy->admit(now, deadline_ns, runtime_ns, sched_ncpus)) < 0) {
+		fprintf(stderr, "Scheduler: %s can't make its deadline, rejected\n",
+			argv[0]);
+		errno = -ret;
+		return -1;
+	}
+	return spawn_task(argv, envp, deadline_ns, runtime_ns);
+}
+
+pid_t sched_fork_task(char *executable)
+{
+	char *newargv[] = { executable, NULL };
+	char *newenviron[] = { NULL };
+
+	return sched_spawn_task(newargv, newenviron);
+}
+
+/* Print a list of all tasks currently being scheduled. */
+void sched_print_tasks(void)
+{
+	char show[SCHED_SHOW_SZ];
+	node *t = proc_list;
+	int c;
+
+	if (sched_ncpus > 1) {
+		for (c = 0; c < sched_ncpus; c++)
+			printf("cpu: %d\ton: %d\ttasks: %d\tsteals: %ld\tstolen: %ld\n",
+				c, cpus[c].cpu, cpus[c].rq.nr, cpus[c].steals, cpus[c].stolen);
+		printf("\n");
+	}
+	if (t == NULL)
+		return;
+	do {
+		show[0] = '\0';
+		if (sched_backend == SCHED_BACKEND_BANDWIDTH)
+			snprintf(show, sizeof(show), "weight: %d", t->cg_weight);
+		else if (policy->show)
+			policy->show(t, show, sizeof(show));
+		printf("id: %d\tpid: %d\tname: %s", t->id, t->pid, t->name);
+		if (sched_ncpus > 1)
+			printf("\tcpu: %d", t->cpu);
+		if (show[0] != '\0')
+			printf("\t%s", show);
+		printf("\n");
+		t = t->next;
+	} while (t != proc_list);
+	printf("\n");
+}
+
+/* Send SIGKILL to a task determined by the value of its
+ * scheduler-specific id.
+ */
+int sched_kill_task_by_id(int id)
+{
+	node *t = accessNode(-1, id);
+
+	if (t != NULL) {
+		/* With a cgroup, all of the task's processes go */
+		if (t->cg_dir >= 0 && cg_kill(t) == 0)
+			return id;
+		if (pidfd_send_signal(t->pidfd.fd, SIGKILL, NULL, 0) < 0)
+			perror("pidfd_send_signal");
+		return id;
+	}
+	return 0;
+}
+
+int sched_set_priority(int id, int high)
+{
+	node *t;
+	int weight, ret;
+
+	if (policy->set_priority == NULL && sched_backend != SCHED_BACKEND_BANDWIDTH)
+		return -ENOSYS;
+	t = accessNode(-1, id);
+	if (t == NULL)
+		return -ESRCH;
+	/* Not on a run queue yet: it is applied once it is enqueued */
+	if (sched_backend != SCHED_BACKEND_BANDWIDTH && t->cpu < 0) {
+		t->prio_pending = 1 + high;
+		return 0;
+	}
+	if (sched_backend != SCHED_BACKEND_BANDWIDTH)
+		return policy->set_priority(&cpus[t->cpu].rq, t, high);
+
+	/* A task still starting gets its weight once it has a cgroup */
+	weight = high ? SCHED_WEIGHT_HIGH : SCHED_WEIGHT_LOW;
+	if (t->cg_dir >= 0 && (ret = cg_set_weight(t, weight)) < 0)
+		return ret;
+	t->cg_weight = weight;
+	return 0;
+}
+
+int sched_set_tickets(int id, int tickets)
+{
+	node *t;
+	int ret;
+
+	if (tickets < 1 || tickets > SCHED_MAX_TICKETS)
+		return -EINVAL;
+	if (policy->set_tickets == NULL && sched_backend != SCHED_BACKEND_BANDWIDTH)
+		return -ENOSYS;
+	t = accessNode(-1, id);
+	if (t == NULL)
+		return -ESRCH;
+
+	/* With bandwidth, tickets are the cpu.weight, within its range */
+	if (sched_backend == SCHED_BACKEND_BANDWIDTH) {
+		if (tickets > SCHED_MAX_WEIGHT)
+			tickets = SCHED_MAX_WEIGHT;
+		if (t->cg_dir >= 0 && (ret = cg_set_weight(t, tickets)) < 0)
+			return ret;
+		t->cg_weight = tickets;
+		return 0;
+	}
+	/* Not on a run queue yet: it is enqueued with them */
+	if (t->cpu < 0) {
+		t->tickets = tickets;
+		return 0;
+	}
+	return policy->set_tickets(&cpus[t->cpu].rq, t, tickets);
+}
+
+void sched_print_stats(void)
+{
+	stats_print();
+}
+
+int sched_dump_stats(const char *path)
+{
+	return stats_dump(path);
+}
+
+/* The running task of a slot has been stopped: account its slice, move on. */
+static void sched_preempted(struct sched_cpu *sc)
+{
+	node *t = sc->current;
+	long long now;
+
+	now = task_cpu_time(t->pid);
+	if (now < 0 || t->cpu_mark < 0)
+		t->slice_ns = sched_quantum(t) * 1000000LL;
+	else
+		t->slice_ns = now - t->cpu_mark;
+	stats_preempted(t);
+	trace_event(TRACE_STOP, sc->rq.cpu, t->id, t->pid, 0, t->slice_ns);
+	policy->on_quantum_expired(&sc->rq, t);
+	sched_dispatch(sc);
+}
+
+/* Stop the running task of a slot, at the end of its quantum or before. */
+static void sched_preempt(struct sched_cpu *sc)
+{
+	int ret;
+
+	/* Before the timer expired, a task has been found more urgent */
+	trace_event(TRACE_PREEMPT, sc->rq.cpu, sc->current->id, sc->current->pid,
+		    sc->expired_ns == 0, 0);
+
+	/* A frozen cgroup needs no stop notification: switch right away */
+	if (sched_backend == SCHED_BACKEND_FREEZER) {
+		if ((ret = cg_freeze(sc->current, 1)) < 0)
+			fprintf(stderr, "Scheduler: freeze %s: %s\n", sc->current->name,
+				strerror(-ret));
+		sched_preempted(sc);
+		return;
+	}
+	if (pidfd_send_signal(sc->current->pidfd.fd, SIGSTOP, NULL, 0) < 0)
+		perror("pidfd_send_signal");
+}
+
+static void sched_timer_expired(struct sched_source *src)
+{
+	struct sched_cpu *sc = src->arg;
+	uint64_t expirations;
+
+	if (read(src->fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+		perror("read timerfd");
+		exit(1);
+	}
+	sc->expired_ns = sc->deadline_ns;
+	if (sc->current != NULL)
+		sched_preempt(sc);
+}
+
+/* A task's pidfd has become readable: reap it. */
+static void sched_task_exited(struct sched_source *src)
+{
+	node *t = src->arg;
+	struct sched_cpu *sc = (t->cpu >= 0) ? &cpus[t->cpu] : NULL;
+	int was_running = (sc != NULL && (t == sc->current ||
+					  sched_backend == SCHED_BACKEND_BANDWIDTH));
+	long long cpu_ns;
+	siginfo_t info;
+
+	/* A zombie's CPU clock still reads its total, until it is reaped */
+	cpu_ns = task_cpu_time(t->pid);
+	info.si_pid = 0;
+	if (waitid(P_PIDFD, src->fd, &info, WEXITED | WNOHANG) < 0) {
+		perror("waitid");
+		exit(1);
+	}
+	if (info.si_pid == 0)
+		return;
+
+	if (sched_verbose)
+		explain_wait_status(info.si_pid, wait_status(&info));
+
+	sched_unwatch(src);
+	close(src->fd);
+	cg_task_release(t);
+	/* The last slice was never accounted, take the total */
+	if (cpu_ns > t->stats.cpu_ns)
+		t->stats.cpu_ns = cpu_ns;
+	stats_task_exited(t, was_running);
+	if (t->deadline_ns != 0 && t->stats.exited_ns > t->deadline_ns)
+		fprintf(stderr, "Scheduler: %s (id %d) missed its deadline by %lld ms\n",
+			t->name, t->id, (t->stats.exited_ns - t->deadline_ns) / 1000000);
+	trace_event(TRACE_EXIT, t->cpu, t->id, t->pid, wait_status(&info), t->stats.cpu_ns);
+	if (sc != NULL) {
+		policy->on_exit(&sc->rq, t);
+		sc->rq.nr--;
+	} else {
+		/* Died before it was ever ready: drop it and carry on */
+		fprintf(stderr, "Scheduler: %s (pid %ld) exited before it was ready, dropping it\n",
+			t->name, (long)t->pid);
+		rqRemove(&starting, t);
+		nstarting--;
+	}
+	deleteNode(t);
+	nproc--;
+	sched_check_startup();
+	if (sched_verbose)
+		printf("Parent: Received SIGCHLD, child is dead.\n");
+	if (was_running)
+		sched_dispatch(sc);
+}
+
+/* If the running task of a slot has stopped, its slice is over. */
+static void sched_check_stopped(struct sched_cpu *sc)
+{
+	node *t = sc->current;
+	siginfo_t info;
+
+	info.si_pid = 0;
+	if (waitid(P_PIDFD, t->pidfd.fd, &info, WSTOPPED | WNOHANG) < 0) {
+		/* ECHILD: it has exited, its pidfd will tell us */
+		if (errno == ECHILD)
+			return;
+		perror("waitid");
+		exit(1);
+	}
+	if (info.si_pid == 0)
+		return;
+
+	if (sched_verbose) {
+		explain_wait_status(info.si_pid, wait_status(&info));
+		printf("Parent: Child has been stopped. Moving right along...\n");
+	}
+	sched_preempted(sc);
+}
+
+/*
+ * SIGCHLD: some child has stopped (exits are seen on the pidfds).
+ * Only the running tasks' stops matter, so look at those alone
+ * instead of scanning every child with waitpid(-1).
+ */
+static void sched_sigchld(struct sched_source *src)
+{
+	struct signalfd_siginfo si;
+	int c;
+
+	while (read(src->fd, &si, sizeof(si)) == sizeof(si))
+		;
+
+	/* Stops are only how tasks are preempted with signals */
+	for (c = 0; c < sched_ncpus && sched_backend == SCHED_BACKEND_SIGNAL; c++)
+		if (cpus[c].current != NULL)
+			sched_check_stopped(&cpus[c]);
+	if (nstarting > 0)
+		sched_check_starting();
+}
+
+void sched_watch(struct sched_source *src)
+{
+	struct epoll_event ev;
+
+	if (epoll_fd < 0) {
+		epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (epoll_fd < 0) {
+			perror("epoll_create1");
+			exit(1);
+		}
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = src;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, src->fd, &ev) < 0) {
+		perror("epoll_ctl: add");
+		exit(1);
+	}
+}
+
+void sched_unwatch(struct sched_source *src)
+{
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, src->fd, NULL) < 0)
+		perror("epoll_ctl: del");
+}
+
+void sched_child_reset_signals(void)
+{
+	sigset_t sigset;
+
+	sigemptyset(&sigset);
+	sigprocmask(SIG_SETMASK, &sigset, NULL);
+	signal(SIGPIPE, SIG_DFL);
+}
+
+/*
+ * Set up the event sources: a timerfd per slot and a signalfd
+ * for SIGCHLD, which is blocked so that it is only seen there.
+ */
+static void create_event_sources(void)
+{
+	sigset_t sigset;
+	int c, fd;
+
+	for (c = 0; c < sched_ncpus; c++) {
+		fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (fd < 0) {
+			perror("timerfd_create");
+			exit(1);
+		}
+		cpus[c].timer_src.fd = fd;
+		cpus[c].timer_src.handle = sched_timer_expired;
+		cpus[c].timer_src.arg = &cpus[c];
+		sched_watch(&cpus[c].timer_src);
+	}
+
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGCHLD);
+	if (sigprocmask(SIG_BLOCK, &sigset, NULL) < 0) {
+		perror("sigprocmask");
+		exit(1);
+	}
+	fd = signalfd(-1, &sigset, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0) {
+		perror("signalfd");
+		exit(1);
+	}
+	sigchld_src.fd = fd;
+	sigchld_src.handle = sched_sigchld;
+	sigchld_src.arg = NULL;
+	sched_watch(&sigchld_src);
+
+	/*
+	 * Ignore SIGPIPE, so that write()s to pipes
+	 * with no reader do not result in us being killed,
+	 * and write() returns EPIPE instead.
+	 */
+	if (signal(SIGPIPE, SIG_IGN) == SIG_ERR) {
+		perror("signal: sigpipe");
+		exit(1);
+	}
+}
+
+void sched_start(void)
+{
+	int c;
+
+	create_event_sources();
+	sched_started = 1;
+	for (c = 0; c < sched_ncpus; c++)
+		sched_dispatch(&cpus[c]);
+	/* Stops reported before SIGCHLD went to the signalfd were lost */
+	sched_check_starting();
+}
+
+/* Wait up to timeout ms (-1: forever) for events and handle them. */
+static void sched_handle_events(int timeout)
+{
+	struct epoll_event events[SCHED_MAX_EVENTS];
+	struct sched_source *src;
+	int i, n;
+
+	n = epoll_wait(epoll_fd, events, SCHED_MAX_EVENTS, timeout);
+	if (n < 0) {
+		if (errno == EINTR)
+			return;
+		perror("epoll_wait");
+		exit(1);
+	}
+	for (i = 0; i < n; i++) {
+		src = events[i].data.ptr;
+		src->handle(src);
+	}
+}
+
+void sched_poll(void)
+{
+	sched_handle_events(0);
+}
+
+void sched_run(void)
+{
+	int ret;
+
+	sched_running = 1;
+	sched_check_startup();
+	while (nproc > 0)
+		sched_handle_events(-1);
+
+	if (sched_stats_path != NULL && (ret = stats_dump(sched_stats_path)) < 0)
+		fprintf(stderr, "Scheduler: %s: %s\n", sched_stats_path, strerror(-ret));
+	trace_close();
+	printf("No processes on the list. Exiting...\n");
+	exit(0);
+}
@@ -0,0 +1,178 @@
+#ifndef SCHED_CORE_H
+#define SCHED_CORE_H
+
+#include <sys/types.h>
+
+#include "task-list.h"
+#include "policy.h"
+
+/******************************************************************************
+ * Scheduler core, shared by scheduler and scheduler-shell.
+ *
+ * Tasks start stopped. By default (-l vfork) they are launched with
+ * vfork() and ptrace(): the child execs under PTRACE_TRACEME and is
+ * detached with SIGSTOP before the new program runs, so it is ready as
+ * soon as that stop has been waited for. With -l fork, or where tracing
+ * isn't allowed, they are fork()ed and raise SIGSTOP before exec, and
+ * are ready once the stop is reported (SIGCHLD).
+ *
+ * They are then run one at a time per dispatch slot: the running task
+ * is stopped with SIGSTOP when its slot's quantum timer expires and the
+ * policy's pick is continued with SIGCONT when the stop is reported.
+ *
+ * With -B freezer, tasks are frozen and thawed through cgroups instead
+ * (see sched-cgroup.h). With -B bandwidth there is no time slicing at
+ * all: every task runs as soon as it is ready, and the kernel shares
+ * out the CPU by the weights of the tasks' cgroups.
+ *
+ * Everything happens in a single-threaded event loop: the timers are
+ * timerfds, every task has a pidfd that reports its exit and SIGCHLD
+ * (for stops) is read from a signalfd, all waited on with epoll
+ * together with any other source, such as the shell's pipe.
+ * Tasks are signalled through their pidfds, so a signal can never
+ * reach a recycled pid.
+ *
+ * With -c N there are N slots, each with its own run queue and timer,
+ * and each pinned to a CPU. Slots balance by stealing waiting tasks
+ * from each other.
+ */
+
+#define SCHED_MAX_CPUS 64
+
+struct sched_cpu {
+	int cpu;                 /* CPU the slot's tasks are pinned to */
+	node *current;           /* running task, NULL if idle */
+	struct sched_source timer_src;  /* quantum timer (timerfd) */
+	long long deadline_ns;   /* when the armed quantum timer expires */
+	long long expired_ns;    /* deadline of the expiry not yet followed by a dispatch */
+	struct runqueue rq;
+	long steals;             /* tasks pulled from other slots */
+	long stolen;             /* tasks pulled by other slots */
+};
+
+extern struct sched_cpu cpus[SCHED_MAX_CPUS];
+extern int sched_ncpus;
+
+/* Number of tasks */
+extern volatile int nproc;
+
+/* The scheduling policy in use */
+extern struct sched_policy *policy;
+
+/* Print a diagnostic for every child status change */
+extern int sched_verbose;
+
+/* Where to dump the statistics on exit (-s), NULL for nowhere */
+extern char *sched_stats_path;
+
+/* Where to record the event trace (-t, see sched-trace.h), NULL for nowhere */
+extern char *sched_trace_path;
+
+/*
+ * How tasks are launched (-l): fork() and a SIGSTOP the child raises
+ * itself, or vfork() and a ptrace stop at exec, which doesn't copy the
+ * scheduler's address space. vfork falls back to fork if tracing is
+ * not allowed.
+ */
+#define SCHED_LAUNCH_FORK  0
+#define SCHED_LAUNCH_VFORK 1
+extern int sched_launcher;
+
+/*
+ * How tasks are stopped and continued (-B): SIGSTOP/SIGCONT, noticing
+ * the stop from SIGCHLD, or by freezing and thawing a cgroup v2 per
+ * task, which takes all of the task's processes along and needs no
+ * notification. The freezer falls back to signals without a writable
+ * cgroup v2 hierarchy.
+ *
+ * Or none of that: with the bandwidth backend the tasks all run at once,
+ * each in a cgroup whose cpu.weight the shell's h and l commands set,
+ * and -M caps each at a percentage of a CPU through cpu.max. Policies
+ * and quanta play no part then, and the task list, killing and the
+ * statistics work as usual. Falls back to signals without a cgroup cpu
+ * controller.
+ */
+#define SCHED_BACKEND_SIGNAL    0
+#define SCHED_BACKEND_FREEZER   1
+#define SCHED_BACKEND_BANDWIDTH 2
+extern int sched_backend;
+
+/* Bandwidth backend: each task's cap in percent of a CPU (-M), 0 for none */
+extern int sched_cpu_max_pct;
+
+/*
+ * Options of the program on top of the scheduler's own: getopt letters,
+ * their usage text and the handler sched_parse_args() passes them to,
+ * which returns -1 for a bad argument.
+ */
+extern const char *sched_extra_opts;
+extern const char *sched_extra_usage;
+extern int (*sched_extra_opt)(int opt, char *arg);
+
+/*
+ * Parse the scheduler options, select and initialize the policy.
+ * Returns the index of the first task in argv.
+ */
+int sched_parse_args(int argc, char *argv[], struct sched_policy *default_policy);
+
+/* Change the base time quantum. It takes effect from the next dispatch on. */
+int sched_set_quantum(int msec);
+
+/*
+ * Add a process to the scheduler's tasks. A ready one has stopped
+ * already and is queued at once; otherwise it's queued as soon as its
+ * stop is reported, or dropped if it exits first.
+ */
+node* sched_add_task(pid_t pid, char *name, int ready);
+
+/* Fork a task that stops itself, then execs executable when continued. */
+pid_t sched_fork_task(char *executable);
+
+/*
+ * Same, executing argv[0] with the given argv and environment.
+ * Returns -1 if the task couldn't be launched.
+ */
+pid_t sched_spawn_task(char *const argv[], char *const envp[]);
+
+/*
+ * Same, for a task that is to be done within deadline_ms from now and
+ * needs about runtime_ms of CPU. Fails with ENOTSUP if the policy has
+ * no deadlines, and with EBUSY if its admission control finds that the
+ * tasks' deadlines couldn't all be met with this one.
+ */
+pid_t sched_spawn_deadline(char *const argv[], char *const envp[],
+			   long deadline_ms, long runtime_ms);
+
+/*
+ * Set up the event loop and dispatch the first tasks. Tasks may be
+ * added before or after: each runs as soon as it's ready, without
+ * waiting for the others.
+ */
+void sched_start(void);
+
+/*
+ * Handle the events that are pending, without waiting: lets tasks
+ * start and quanta expire while a long list of tasks is launched.
+ * Not to be called from an event handler.
+ */
+void sched_poll(void);
+
+/* Run the event loop until every task has exited, then exit. */
+void sched_run(void);
+
+/* Add/remove an event loop source */
+void sched_watch(struct sched_source *src);
+void sched_unwatch(struct sched_source *src);
+
+/* In a forked child: undo the scheduler's signal setup before exec. */
+void sched_child_reset_signals(void);
+
+/* Shell requests */
+void sched_print_tasks(void);
+int sched_kill_task_by_id(int id);
+int sched_set_priority(int id, int high);
+int sched_set_tickets(int id, int tickets);
+void sched_print_stats(void);
+int sched_dump_stats(const char *path);
+
+#endif /* SCHED_CORE_H */
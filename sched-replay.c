@@ -0,0 +1,406 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "request.h"
+#include "sched-trace.h"
+
+/*
+ * Offline analysis of a scheduler event trace (scheduler -t file).
+ *
+ * Replays the records in order to rebuild what each task went through:
+ * when it was created, first dispatched and exited, how often it was
+ * dispatched and preempted, and how long it spent running and waiting,
+ * counted as the scheduler's own statistics count them (waiting from
+ * creation to each dispatch, running from each dispatch to the end of
+ * the slice). Then sums up turnaround, wait and response times and the
+ * dispatch latency over the tasks, and the shell's requests.
+ *
+ * With -e, prints every event as well; with -i id, the events of that
+ * task only. If the ring has wrapped, the oldest events are gone and
+ * the tasks that were created before the first one left are marked.
+ */
+
+struct replay_task {
+	int seen;
+	int id;
+	pid_t pid;
+	char name[TRACE_NAME_SZ + 1];
+	long long created_ns;    /* -1 if before the trace's first record */
+	long long first_ns;      /* first dispatch, -1 for none */
+	long long exited_ns;     /* -1 if still alive at the end */
+	long long since_ns;      /* start of the current run or wait, -1 if unknown */
+	int running;
+	int status;              /* wait status */
+	long dispatches, preempts, early, steals;
+	long long run_ns, wait_ns, cpu_ns;
+};
+
+static struct replay_task *tasks = NULL;
+static int ntasks = 0;
+
+/* Dispatch latencies, and the requests by type */
+static long long *latencies = NULL;
+static long nlatencies = 0, latencies_cap = 0;
+static long requests[REQ_SET_TICKETS + 1], failed_requests;
+
+static const char *event_names[TRACE_NR_EVENTS] = {
+	[TRACE_CREATE] = "create",
+	[TRACE_READY] = "ready",
+	[TRACE_DISPATCH] = "dispatch",
+	[TRACE_PREEMPT] = "preempt",
+	[TRACE_STOP] = "stop",
+	[TRACE_EXIT] = "exit",
+	[TRACE_STEAL] = "steal",
+	[TRACE_REQUEST] = "request",
+};
+
+static const char *request_names[REQ_SET_TICKETS + 1] = {
+	[REQ_PRINT_TASKS] = "print",
+	[REQ_KILL_TASK] = "kill",
+	[REQ_EXEC_TASK] = "exec",
+	[REQ_HIGH_TASK] = "high",
+	[REQ_LOW_TASK] = "low",
+	[REQ_SET_QUANTUM] = "quantum",
+	[REQ_PRINT_STATS] = "stats",
+	[REQ_DUMP_STATS] = "dump",
+	[REQ_BATCH] = "batch",
+	[REQ_EXEC_ARGV] = "exec_argv",
+	[REQ_SET_TICKETS] = "tickets",
+};
+
+static void usage(char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-e] [-i id] trace_file\n", argv0);
+	exit(1);
+}
+
+static void *xrealloc(void *p, size_t size)
+{
+	p = realloc(p, size);
+	if (p == NULL) {
+		perror("realloc");
+		exit(1);
+	}
+	return p;
+}
+
+/* The task with the given id, first seen now if it hasn't been */
+static struct replay_task *get_task(int id, pid_t pid)
+{
+	struct replay_task *t;
+	int n;
+
+	if (id >= ntasks) {
+		n = ntasks ? 2 * ntasks : 64;
+		while (n <= id)
+			n *= 2;
+		tasks = xrealloc(tasks, n * sizeof(*tasks));
+		memset(tasks + ntasks, 0, (n - ntasks) * sizeof(*tasks));
+		ntasks = n;
+	}
+	t = &tasks[id];
+	if (!t->seen) {
+		t->seen = 1;
+		t->id = id;
+		t->pid = pid;
+		strcpy(t->name, "?");
+		t->created_ns = t->first_ns = t->exited_ns = t->since_ns = -1;
+	}
+	return t;
+}
+
+/* Close the current run or wait of t at ts */
+static void account(struct replay_task *t, long long ts)
+{
+	if (t->since_ns >= 0) {
+		if (t->running)
+			t->run_ns += ts - t->since_ns;
+		else
+			t->wait_ns += ts - t->since_ns;
+	}
+	t->since_ns = ts;
+}
+
+static void replay(struct trace_record *r)
+{
+	struct replay_task *t;
+
+	if (r->type == TRACE_REQUEST) {
+		if (r->aux >= 0 && r->aux <= REQ_SET_TICKETS)
+			requests[r->aux]++;
+		if (r->arg < 0)
+			failed_requests++;
+		return;
+	}
+	if (r->id < 0)
+		return;
+
+	t = get_task(r->id, r->pid);
+	switch (r->type) {
+		case TRACE_CREATE:
+			memcpy(t->name, r->name, TRACE_NAME_SZ);
+			t->created_ns = t->since_ns = r->ts_ns;
+			break;
+		case TRACE_DISPATCH:
+			account(t, r->ts_ns);
+			t->running = 1;
+			t->dispatches++;
+			if (t->first_ns < 0 && t->created_ns >= 0)
+				t->first_ns = r->ts_ns;
+			if (r->arg >= 0) {
+				if (nlatencies == latencies_cap) {
+					latencies_cap = latencies_cap ? 2 * latencies_cap : 1024;
+					latencies = xrealloc(latencies, latencies_cap * sizeof(*latencies));
+				}
+				latencies[nlatencies++] = r->arg;
+			}
+			break;
+		case TRACE_PREEMPT:
+			t->preempts++;
+			t->early += r->aux;
+			break;
+		case TRACE_STOP:
+			account(t, r->ts_ns);
+			t->running = 0;
+			t->cpu_ns += r->arg;
+			break;
+		case TRACE_EXIT:
+			account(t, r->ts_ns);
+			t->running = 0;
+			t->exited_ns = r->ts_ns;
+			t->status = r->aux;
+			t->cpu_ns = r->arg;
+			break;
+		case TRACE_STEAL:
+			t->steals++;
+			break;
+	}
+}
+
+static void print_event(struct trace_header *h, struct trace_record *r)
+{
+	printf("%12.3f  cpu %2d  %-8s  id %-5d pid %-7d", (r->ts_ns - h->start_ns) / 1e6,
+		r->cpu, r->type < TRACE_NR_EVENTS ? event_names[r->type] : "?",
+		r->id, r->pid);
+	switch (r->type) {
+		case TRACE_CREATE:
+			printf("  %.*s", TRACE_NAME_SZ, r->name);
+			break;
+		case TRACE_DISPATCH:
+			if (r->arg >= 0)
+				printf("  latency %lld us", (long long)r->arg / 1000);
+			break;
+		case TRACE_PREEMPT:
+			if (r->aux)
+				printf("  early");
+			break;
+		case TRACE_STOP:
+			printf("  cpu %.3f ms", r->arg / 1e6);
+			break;
+		case TRACE_EXIT:
+			printf("  status 0x%x, cpu %.3f ms", r->aux, r->arg / 1e6);
+			break;
+		case TRACE_STEAL:
+			printf("  from cpu %d", r->aux);
+			break;
+		case TRACE_REQUEST:
+			printf("  %s = %lld",
+				r->aux >= 0 && r->aux <= REQ_SET_TICKETS ? request_names[r->aux] : "?",
+				(long long)r->arg);
+			break;
+	}
+	printf("\n");
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Mean, median, p99 and max of v[n] in ms, which sorts v */
+static void print_summary(const char *what, long long *v, long n)
+{
+	long long sum = 0;
+	long i;
+
+	if (n == 0) {
+		printf("%-14s (none)\n", what);
+		return;
+	}
+	qsort(v, n, sizeof(*v), cmp_ll);
+	for (i = 0; i < n; i++)
+		sum += v[i];
+	printf("%-14s n %-6ld mean %10.3f  p50 %10.3f  p99 %10.3f  max %10.3f ms\n",
+		what, n, (double)sum / n / 1e6, v[(n - 1) / 2] / 1e6,
+		v[(n * 99 + 99) / 100 - 1] / 1e6, v[n - 1] / 1e6);
+}
+
+static void status_str(struct replay_task *t, char *buf, size_t len)
+{
+	if (t->exited_ns < 0)
+		snprintf(buf, len, "live");
+	else if (WIFSIGNALED(t->status))
+		snprintf(buf, len, "sig %d", WTERMSIG(t->status));
+	else
+		snprintf(buf, len, "exit %d", WEXITSTATUS(t->status));
+}
+
+static void print_tasks(long long end_ns)
+{
+	long long *turnaround, *wait, *response;
+	long nturnaround = 0, nwait = 0, nresponse = 0, partial = 0;
+	struct replay_task *t;
+	char status[16];
+	int i;
+
+	turnaround = xrealloc(NULL, (ntasks + 1) * sizeof(long long));
+	wait = xrealloc(NULL, (ntasks + 1) * sizeof(long long));
+	response = xrealloc(NULL, (ntasks + 1) * sizeof(long long));
+
+	printf("id\tpid\tquanta\tpreempt\tsteals\trun_ms\twait_ms\tcpu_ms\tresp_ms\tturn_ms\tstatus\tname\n");
+	for (i = 0; i < ntasks; i++) {
+		t = &tasks[i];
+		if (!t->seen)
+			continue;
+		/* Still going at the end of the trace */
+		account(t, t->exited_ns >= 0 ? t->exited_ns : end_ns);
+		status_str(t, status, sizeof(status));
+		printf("%d\t%d\t%ld\t%ld\t%ld\t%lld\t%lld\t%lld\t", t->id, t->pid,
+			t->dispatches, t->preempts, t->steals, t->run_ns / 1000000,
+			t->wait_ns / 1000000, t->cpu_ns / 1000000);
+		if (t->first_ns >= 0)
+			printf("%lld\t", (t->first_ns - t->created_ns) / 1000000);
+		else
+			printf("-\t");
+		if (t->created_ns >= 0 && t->exited_ns >= 0)
+			printf("%lld\t", (t->exited_ns - t->created_ns) / 1000000);
+		else
+			printf("-\t");
+		printf("%s\t%s%s\n", status, t->name, t->created_ns < 0 ? " (partial)" : "");
+
+		if (t->created_ns < 0) {
+			partial++;
+			continue;
+		}
+		if (t->exited_ns >= 0) {
+			turnaround[nturnaround++] = t->exited_ns - t->created_ns;
+			wait[nwait++] = t->wait_ns;
+		}
+		if (t->first_ns >= 0)
+			response[nresponse++] = t->first_ns - t->created_ns;
+	}
+
+	printf("\nover the tasks that exited%s:\n",
+		partial ? ", not counting those created before the trace" : "");
+	print_summary("turnaround", turnaround, nturnaround);
+	print_summary("wait", wait, nwait);
+	printf("over the tasks dispatched:\n");
+	print_summary("response", response, nresponse);
+	printf("over the dispatches after a preemption:\n");
+	print_summary("latency", latencies, nlatencies);
+
+	free(turnaround);
+	free(wait);
+	free(response);
+}
+
+static void print_requests(void)
+{
+	long total = 0;
+	int i;
+
+	for (i = 0; i <= REQ_SET_TICKETS; i++)
+		total += requests[i];
+	if (total == 0)
+		return;
+	printf("\nrequests: %ld, %ld failed:", total, failed_requests);
+	for (i = 0; i <= REQ_SET_TICKETS; i++)
+		if (requests[i])
+			printf(" %s %ld", request_names[i], requests[i]);
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct trace_header *h;
+	struct trace_record *ring, *r;
+	struct stat st;
+	uint64_t first, n;
+	long long end_ns;
+	int fd, opt, events = 0, only = -1;
+
+	while ((opt = getopt(argc, argv, "ei:")) != -1) {
+		switch (opt) {
+			case 'e':
+				events = 1;
+				break;
+			case 'i':
+				only = atoi(optarg);
+				events = 1;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+
+	fd = open(argv[optind], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(argv[optind]);
+		exit(1);
+	}
+	if ((size_t)st.st_size < sizeof(*h)) {
+		fprintf(stderr, "%s: not a scheduler trace\n", argv[optind]);
+		exit(1);
+	}
+	h = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (h == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	close(fd);
+	if (memcmp(h->magic, TRACE_MAGIC, sizeof(h->magic)) != 0 ||
+	    h->version != TRACE_VERSION || h->record_size != sizeof(*r) ||
+	    h->nrecords == 0 ||
+	    (size_t)st.st_size < sizeof(*h) + h->nrecords * sizeof(*r)) {
+		fprintf(stderr, "%s: not a scheduler trace, or of another version\n",
+			argv[optind]);
+		exit(1);
+	}
+	ring = (struct trace_record *)(h + 1);
+
+	first = h->head > h->nrecords ? h->head - h->nrecords : 0;
+	printf("policy %.*s, %d cpus, quantum %d ms: %llu events",
+		(int)sizeof(h->policy), h->policy, h->ncpus, h->quantum_ms,
+		(unsigned long long)(h->head - first));
+	if (first > 0)
+		printf(", the first %llu overwritten", (unsigned long long)first);
+	printf("\n\n");
+
+	end_ns = h->start_ns;
+	for (n = first; n < h->head; n++) {
+		r = &ring[n % h->nrecords];
+		if (events && (only < 0 || (r->id == only && r->type != TRACE_REQUEST)))
+			print_event(h, r);
+		replay(r);
+		end_ns = r->ts_ns;
+	}
+	if (events)
+		printf("\n");
+
+	printf("%.3f s traced\n", (end_ns - h->start_ns) / 1e9);
+	print_tasks(end_ns);
+	print_requests();
+	return 0;
+}
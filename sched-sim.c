@@ -0,0 +1,761 @@
+#include <math.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/stat.h>
+
+#include "policy.h"
+
+/*
+ * Discrete-event simulator for the scheduling policies.
+ *
+ * Runs the policies of the scheduler, unchanged, on synthetic tasks in
+ * virtual time: no processes, no signals and no waiting, so millions of
+ * tasks take seconds. Each task arrives at some time and then
+ * alternates CPU bursts with I/O waits; the simulator plays the part of
+ * the scheduler core, with the same slots, stealing, preemption and
+ * accounting, and the policies see virtual time through policy_now_ns().
+ *
+ * Like the scheduler, which can only stop and continue its tasks, the
+ * simulator doesn't know when a task blocks: a task waiting for I/O
+ * when its slice comes holds its slot until the quantum is up, and
+ * gets nothing done. Its I/O completes meanwhile all the same.
+ *
+ * Tasks are generated from -S seed (the same tasks for every policy and
+ * quantum), for a load of -l times the slots' capacity, or read from a
+ * file (-f), one task a line:
+ *
+ *   arrival_ms burst_ms [io_ms burst_ms]...
+ *
+ * with nondecreasing arrival times. For each policy and quantum, prints
+ * turnaround and response times (mean and p99), the mean slowdown
+ * (turnaround over the time the task would take alone, bounded below by
+ * SIM_SLOWDOWN_MIN_MS so that tiny tasks don't swamp it), Jain's
+ * fairness index over the slowdowns (1 when every task is slowed down
+ * alike),
+ * the slots' utilization and the number of dispatches, and with -o
+ * appends them to a CSV file.
+ */
+
+#define SIM_MAX_LIST 16
+#define SIM_TASKS 1000000
+#define SIM_LOAD 0.8
+#define SIM_BURST_MS 5.0
+#define SIM_BURSTS 1
+#define SIM_IO_MS 10.0
+#define SIM_LINE_SZ 4096
+#define SIM_SLOWDOWN_MIN_MS 10        /* shorter tasks count as this long */
+
+struct sim_config {
+	char *policies[SIM_MAX_LIST];
+	int npolicies;
+	long quanta[SIM_MAX_LIST];
+	int nquanta;
+	int nslots;
+	long ntasks;
+	double load, burst_ms, io_ms;
+	int bursts;
+	double deadline_factor;   /* deadline at arrival + factor * time alone, 0 for none */
+	long switch_us;           /* dispatch cost */
+	unsigned long seed;
+	char *workload;           /* file, NULL to generate */
+	char *csv;
+};
+
+/*
+ * A simulated task. Its phases alternate CPU bursts (even) and I/O
+ * waits (odd), starting and ending with a burst; it is the node's pid
+ * that leads back here from the policies' picks.
+ */
+struct sim_task {
+	node *t;
+	long long arrival_ns, first_ns, alone_ns;
+	long long *phase;
+	int nphases;
+	int next_free;            /* free list of tasks[] */
+	/* Progress, which the simulator can look ahead on a copy of */
+	struct sim_progress {
+		int cur;              /* current phase */
+		long long left_ns;    /* of the current burst */
+		long long io_done_ns; /* end of the current I/O wait */
+	} p;
+};
+
+struct sim_slot {
+	struct runqueue rq;
+	node *current;
+	long long start_ns;       /* when current got the CPU */
+	long gen;                 /* events of older slices are stale */
+};
+
+#define SIM_EV_ARRIVAL 0
+#define SIM_EV_SLOT 1
+
+struct sim_event {
+	long long at;
+	long seq;                 /* ties go in order of scheduling */
+	int kind;
+	int slot;
+	long gen;
+};
+
+struct sim_result {
+	long tasks, rejected, missed, dispatches;
+	double makespan_s;
+	double turnaround_mean_ms, turnaround_p99_ms;
+	double response_mean_ms, response_p99_ms;
+	double slowdown, fairness, utilization;
+	double wall_ms;
+};
+
+/* Base time quantum, for the policies */
+long sched_tq_msec;
+
+static long long sim_now;
+static struct sim_config *cfg;
+
+static struct sim_slot slots[SIM_MAX_LIST];
+static struct sched_policy *policy;
+
+static struct sim_event *events;
+static long nevents, events_cap, event_seq;
+
+static struct sim_task *tasks;
+static int ntasks_cap, free_task = -1, nlive;
+
+/* The next arrival, read or generated ahead */
+static struct sim_task next_arrival;
+static int have_arrival;
+static long arrivals;
+static FILE *workload_fp;
+static long workload_line;
+
+static unsigned long rng;
+
+/* Per run results, over the tasks that exited */
+static long long *turnaround, *response;
+static long nturnaround, nresponse, results_cap;
+static double slowdown_sum, slowdown_sq;
+static long long busy_ns, first_arrival_ns, last_exit_ns;
+static struct sim_result res;
+
+long long policy_now_ns(void)
+{
+	return sim_now;
+}
+
+static void usage(char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [-p policy[,policy...]] [-q ms[,ms...]] [-c slots] [-n tasks]\n"
+		"       [-l load] [-b burst_ms] [-k bursts] [-w io_ms] [-d deadline_factor]\n"
+		"       [-x switch_us] [-S seed] [-f workload] [-o file.csv]\n", argv0);
+	exit(1);
+}
+
+static void *xrealloc(void *p, size_t size)
+{
+	p = realloc(p, size);
+	if (p == NULL) {
+		perror("realloc");
+		exit(1);
+	}
+	return p;
+}
+
+/* Split a comma-separated option argument, in place */
+static int split_list(char *arg, char **out)
+{
+	int n = 0;
+	char *tok;
+
+	for (tok = strtok(arg, ","); tok != NULL; tok = strtok(NULL, ",")) {
+		if (n == SIM_MAX_LIST) {
+			fprintf(stderr, "Too many list entries, max %d\n", SIM_MAX_LIST);
+			exit(1);
+		}
+		out[n++] = tok;
+	}
+	return n;
+}
+
+/* xorshift64 */
+static unsigned long next_rand(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return rng;
+}
+
+/* Exponentially distributed, with the given mean, in ns, at least 1 us */
+static long long rand_exp_ns(double mean_ms)
+{
+	double u = ((next_rand() >> 11) + 1.0) / 9007199254740993.0;
+	long long ns = -log(u) * mean_ms * 1e6;
+
+	return ns < 1000 ? 1000 : ns;
+}
+
+/*
+ * The event queue: a binary min-heap by time, then by order of
+ * scheduling, so that a run is the same every time.
+ */
+static int event_before(struct sim_event *a, struct sim_event *b)
+{
+	return a->at < b->at || (a->at == b->at && a->seq < b->seq);
+}
+
+static void event_push(long long at, int kind, int slot, long gen)
+{
+	struct sim_event ev = { at, event_seq++, kind, slot, gen }, tmp;
+	long i, up;
+
+	if (nevents == events_cap) {
+		events_cap = events_cap ? 2 * events_cap : 256;
+		events = xrealloc(events, events_cap * sizeof(*events));
+	}
+	events[i = nevents++] = ev;
+	for (; i > 0 && event_before(&events[i], &events[up = (i - 1) / 2]); i = up) {
+		tmp = events[i];
+		events[i] = events[up];
+		events[up] = tmp;
+	}
+}
+
+static struct sim_event event_pop(void)
+{
+	struct sim_event top = events[0], tmp;
+	long i = 0, c;
+
+	events[0] = events[--nevents];
+	while ((c = 2 * i + 1) < nevents) {
+		if (c + 1 < nevents && event_before(&events[c + 1], &events[c]))
+			c++;
+		if (!event_before(&events[c], &events[i]))
+			break;
+		tmp = events[i];
+		events[i] = events[c];
+		events[c] = tmp;
+		i = c;
+	}
+	return top;
+}
+
+/* Generate the next task; 0 once there are cfg->ntasks */
+static int generate_task(struct sim_task *st)
+{
+	static long long arrival_ns;
+	double gap_ms = cfg->burst_ms * cfg->bursts / (cfg->load * cfg->nslots);
+	int i, n;
+
+	if (arrivals == cfg->ntasks)
+		return 0;
+	if (arrivals == 0)
+		arrival_ns = 0;
+	arrival_ns += rand_exp_ns(gap_ms);
+	st->arrival_ns = arrival_ns;
+
+	/* 1 to 2 * bursts - 1 bursts, bursts on average */
+	n = 2 * (next_rand() % (2 * cfg->bursts - 1) + 1) - 1;
+	st->phase = xrealloc(NULL, n * sizeof(*st->phase));
+	st->nphases = n;
+	for (i = 0; i < n; i++)
+		st->phase[i] = rand_exp_ns(i % 2 ? cfg->io_ms : cfg->burst_ms);
+	return 1;
+}
+
+/* Read the next task from the workload file; 0 at its end */
+static int read_task(struct sim_task *st)
+{
+	static long long last_ns;
+	char line[SIM_LINE_SZ], *p, *end;
+	double v;
+	int n;
+
+	while (fgets(line, sizeof(line), workload_fp) != NULL) {
+		workload_line++;
+		p = line + strspn(line, " \t");
+		if (*p == '#' || *p == '\n' || *p == '\0')
+			continue;
+		st->phase = NULL;
+		for (n = -1; ; n++) {
+			v = strtod(p, &end);
+			if (end == p)
+				break;
+			p = end;
+			if (n < 0) {
+				st->arrival_ns = v * 1e6;
+				continue;
+			}
+			st->phase = xrealloc(st->phase, (n + 1) * sizeof(*st->phase));
+			st->phase[n] = v * 1e6 < 1000 ? 1000 : v * 1e6;
+		}
+		if (n < 1 || n % 2 == 0 || (arrivals > 0 && st->arrival_ns < last_ns) ||
+		    strspn(p, " \t\r\n") != strlen(p)) {
+			fprintf(stderr, "%s:%ld: bad task, expected "
+				"arrival_ms burst_ms [io_ms burst_ms]..., "
+				"arriving in order\n", cfg->workload, workload_line);
+			exit(1);
+		}
+		st->nphases = n;
+		last_ns = st->arrival_ns;
+		return 1;
+	}
+	return 0;
+}
+
+/* Fetch the next arrival and schedule it */
+static void next_task(void)
+{
+	struct sim_task *st = &next_arrival;
+
+	have_arrival = cfg->workload ? read_task(st) : generate_task(st);
+	if (!have_arrival)
+		return;
+	arrivals++;
+	event_push(st->arrival_ns, SIM_EV_ARRIVAL, 0, 0);
+}
+
+/* Take a free sim_task, growing tasks[] as needed */
+static int alloc_task(void)
+{
+	int i;
+
+	if (free_task < 0) {
+		i = ntasks_cap;
+		ntasks_cap = ntasks_cap ? 2 * ntasks_cap : 1024;
+		tasks = xrealloc(tasks, ntasks_cap * sizeof(*tasks));
+		for (; i < ntasks_cap; i++) {
+			tasks[i].next_free = free_task;
+			free_task = i;
+		}
+	}
+	i = free_task;
+	free_task = tasks[i].next_free;
+	return i;
+}
+
+static struct sim_task *task_of(node *t)
+{
+	return &tasks[t->pid];
+}
+
+/*
+ * Let a task run from from to to (or until it exits), updating p.
+ * Returns the CPU time it used; *exit_ns is set to when it exited,
+ * -1 if it didn't.
+ */
+static long long advance(struct sim_task *st, struct sim_progress *p,
+			 long long from, long long to, long long *exit_ns)
+{
+	long long now = from, cpu = 0, run;
+
+	*exit_ns = -1;
+	while (now < to) {
+		if (p->cur % 2 == 1) {
+			/* Waiting for I/O: nothing to do before it is done */
+			if (p->io_done_ns >= to)
+				break;
+			if (p->io_done_ns > now)
+				now = p->io_done_ns;
+			p->left_ns = st->phase[++p->cur];
+			continue;
+		}
+		run = p->left_ns < to - now ? p->left_ns : to - now;
+		p->left_ns -= run;
+		cpu += run;
+		now += run;
+		if (p->left_ns > 0)
+			break;
+		if (p->cur == st->nphases - 1) {
+			*exit_ns = now;
+			break;
+		}
+		p->io_done_ns = now + st->phase[++p->cur];
+	}
+	return cpu;
+}
+
+/* The same as sched_enqueue() and sched_steal() in the scheduler */
+static void sim_enqueue(struct sim_slot *sl, node *t)
+{
+	t->cpu = sl->rq.cpu;
+	policy->enqueue(&sl->rq, t);
+	sl->rq.nr++;
+}
+
+static void sim_steal(struct sim_slot *sl)
+{
+	struct sim_slot *victim = NULL;
+	node *t;
+	int c;
+
+	if (policy->steal == NULL)
+		return;
+	for (c = 0; c < cfg->nslots; c++)
+		if (&slots[c] != sl && (victim == NULL || slots[c].rq.nr > victim->rq.nr))
+			victim = &slots[c];
+	if (victim == NULL || (sl->rq.nr > 0 && victim->rq.nr - sl->rq.nr <= 1))
+		return;
+
+	t = policy->steal(&victim->rq, victim->current);
+	if (t == NULL)
+		return;
+	policy->dequeue(&victim->rq, t);
+	victim->rq.nr--;
+	sim_enqueue(sl, t);
+}
+
+/* Give the policy's pick a quantum, and schedule the end of its slice */
+static void sim_dispatch(struct sim_slot *sl)
+{
+	struct sim_progress ahead;
+	struct sim_task *st;
+	long long end, exit_ns;
+	long quantum;
+
+	sl->gen++;
+	sim_steal(sl);
+	sl->current = policy->pick_next(&sl->rq);
+	if (sl->current == NULL)
+		return;
+
+	st = task_of(sl->current);
+	if (st->first_ns < 0)
+		st->first_ns = sim_now;
+	res.dispatches++;
+	quantum = policy->quantum ? policy->quantum(sl->current) : sched_tq_msec;
+	sl->start_ns = sim_now + cfg->switch_us * 1000;
+	end = sl->start_ns + quantum * 1000000LL;
+
+	/* Unless preempted, the slice ends with the quantum or the task */
+	ahead = st->p;
+	advance(st, &ahead, sl->start_ns, end, &exit_ns);
+	event_push(exit_ns >= 0 ? exit_ns : end, SIM_EV_SLOT, sl - slots, sl->gen);
+}
+
+static void sim_exited(struct sim_slot *sl, struct sim_task *st)
+{
+	node *t = st->t;
+	long long turn = sim_now - st->arrival_ns;
+	long long alone = st->alone_ns;
+	double slowdown;
+
+	if (alone < SIM_SLOWDOWN_MIN_MS * 1000000LL)
+		alone = SIM_SLOWDOWN_MIN_MS * 1000000LL;
+	slowdown = turn > alone ? (double)turn / alone : 1;
+	if (t->deadline_ns != 0 && sim_now > t->deadline_ns)
+		res.missed++;
+	policy->on_exit(&sl->rq, t);
+	sl->rq.nr--;
+	deleteNode(t);
+
+	if (nturnaround == results_cap) {
+		results_cap = results_cap ? 2 * results_cap : 1024;
+		turnaround = xrealloc(turnaround, results_cap * sizeof(*turnaround));
+		response = xrealloc(response, results_cap * sizeof(*response));
+	}
+	turnaround[nturnaround++] = turn;
+	response[nresponse++] = st->first_ns - st->arrival_ns;
+	slowdown_sum += slowdown;
+	slowdown_sq += slowdown * slowdown;
+	last_exit_ns = sim_now;
+
+	free(st->phase);
+	st->next_free = free_task;
+	free_task = st - tasks;
+	nlive--;
+}
+
+/*
+ * The running task of a slot is stopped now, at the end of its quantum,
+ * on exit or preempted: account for its slice and move on.
+ */
+static void sim_slice_over(struct sim_slot *sl)
+{
+	struct sim_task *st = task_of(sl->current);
+	long long exit_ns, cpu = 0;
+
+	if (sim_now > sl->start_ns)
+		cpu = advance(st, &st->p, sl->start_ns, sim_now, &exit_ns);
+	else
+		exit_ns = -1;
+	busy_ns += cpu;
+	sl->current->slice_ns = cpu;
+	if (exit_ns >= 0)
+		sim_exited(sl, st);
+	else
+		policy->on_quantum_expired(&sl->rq, sl->current);
+	sim_dispatch(sl);
+}
+
+/* The same as sched_task_ready(): the least loaded slot gets the task */
+static void sim_arrival(void)
+{
+	struct sim_slot *sl = &slots[0];
+	struct sim_task *st;
+	long long cpu = 0;
+	int i, c;
+
+	for (c = 1; c < cfg->nslots; c++)
+		if (slots[c].rq.nr < sl->rq.nr)
+			sl = &slots[c];
+
+	i = alloc_task();
+	st = &tasks[i];
+	st->arrival_ns = next_arrival.arrival_ns;
+	st->phase = next_arrival.phase;
+	st->nphases = next_arrival.nphases;
+	st->first_ns = -1;
+	st->alone_ns = 0;
+	for (c = 0; c < st->nphases; c++) {
+		st->alone_ns += st->phase[c];
+		if (c % 2 == 0)
+			cpu += st->phase[c];
+	}
+	st->p.cur = 0;
+	st->p.left_ns = st->phase[0];
+	if (first_arrival_ns < 0)
+		first_arrival_ns = sim_now;
+	next_task();
+
+	st->t = addNode(i, "sim");
+	if (cfg->deadline_factor > 0) {
+		st->t->deadline_ns = sim_now + cfg->deadline_factor * st->alone_ns;
+		st->t->runtime_ns = cpu;
+		if (policy->admit != NULL &&
+		    policy->admit(sim_now, st->t->deadline_ns, cpu, cfg->nslots) < 0) {
+			res.rejected++;
+			deleteNode(st->t);
+			free(st->phase);
+			st->next_free = free_task;
+			free_task = i;
+			return;
+		}
+	}
+	nlive++;
+	res.tasks++;
+
+	sim_enqueue(sl, st->t);
+	if (sl->current == NULL)
+		sim_dispatch(sl);
+	else if (policy->preempts != NULL && policy->preempts(&sl->rq, st->t, sl->current))
+		sim_slice_over(sl);
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Mean and p99 of v[n] in ms, which sorts v */
+static void summarize(long long *v, long n, double *mean_ms, double *p99_ms)
+{
+	long long sum = 0;
+	long i;
+
+	*mean_ms = *p99_ms = 0;
+	if (n == 0)
+		return;
+	for (i = 0; i < n; i++)
+		sum += v[i];
+	qsort(v, n, sizeof(*v), cmp_ll);
+	*mean_ms = (double)sum / n / 1e6;
+	*p99_ms = v[(99 * n + 99) / 100 - 1] / 1e6;
+}
+
+/* Simulate every task under the policy with the given quantum */
+static void simulate(const char *name, long quantum)
+{
+	struct timespec t0, t1;
+	struct sim_event ev;
+	int c;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	policy = find_policy(name);
+	sched_tq_msec = quantum;
+	sim_now = 0;
+	memset(&res, 0, sizeof(res));
+	nturnaround = nresponse = 0;
+	slowdown_sum = slowdown_sq = 0;
+	busy_ns = 0;
+	first_arrival_ns = last_exit_ns = -1;
+	nevents = event_seq = 0;
+	arrivals = 0;
+
+	for (c = 0; c < cfg->nslots; c++) {
+		memset(&slots[c], 0, sizeof(slots[c]));
+		slots[c].rq.cpu = c;
+		policy->init(&slots[c].rq);
+	}
+	/* After init, which may have seeded it from the clock */
+	srand(cfg->seed);
+	rng = cfg->seed;
+	if (cfg->workload != NULL) {
+		rewind(workload_fp);
+		workload_line = 0;
+	}
+
+	next_task();
+	while (nevents > 0) {
+		ev = event_pop();
+		sim_now = ev.at;
+		if (ev.kind == SIM_EV_ARRIVAL)
+			sim_arrival();
+		else if (ev.gen == slots[ev.slot].gen)
+			sim_slice_over(&slots[ev.slot]);
+	}
+	/* Every task is gone: the queues can go too, before the next run */
+	for (c = 0; c < cfg->nslots; c++)
+		policy->destroy(&slots[c].rq);
+
+	res.makespan_s = (last_exit_ns - first_arrival_ns) / 1e9;
+	summarize(turnaround, nturnaround, &res.turnaround_mean_ms, &res.turnaround_p99_ms);
+	summarize(response, nresponse, &res.response_mean_ms, &res.response_p99_ms);
+	if (nturnaround > 0) {
+		res.slowdown = slowdown_sum / nturnaround;
+		res.fairness = slowdown_sum * slowdown_sum / (nturnaround * slowdown_sq);
+		res.utilization = busy_ns / (1e9 * res.makespan_s * cfg->nslots);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	res.wall_ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+}
+
+static FILE *open_csv(const char *path)
+{
+	struct stat st;
+	FILE *fp;
+
+	if ((fp = fopen(path, "a")) == NULL) {
+		perror(path);
+		exit(1);
+	}
+	if (fstat(fileno(fp), &st) == 0 && st.st_size == 0)
+		fprintf(fp, "policy,quantum_ms,slots,tasks,rejected,missed,makespan_s,"
+			"turnaround_mean_ms,turnaround_p99_ms,response_mean_ms,"
+			"response_p99_ms,slowdown,fairness,utilization,dispatches,"
+			"wall_ms\n");
+	return fp;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sim_config config = {
+		.nslots = 1, .ntasks = SIM_TASKS, .load = SIM_LOAD,
+		.burst_ms = SIM_BURST_MS, .bursts = SIM_BURSTS, .io_ms = SIM_IO_MS,
+		.seed = 1,
+	};
+	char *list[SIM_MAX_LIST];
+	int opt, i, p, q;
+	FILE *csv = NULL;
+
+	cfg = &config;
+	while ((opt = getopt(argc, argv, "p:q:c:n:l:b:k:w:d:x:S:f:o:")) != -1) {
+		switch (opt) {
+			case 'p':
+				cfg->npolicies = split_list(optarg, cfg->policies);
+				break;
+			case 'q':
+				cfg->nquanta = split_list(optarg, list);
+				for (i = 0; i < cfg->nquanta; i++)
+					if ((cfg->quanta[i] = atol(list[i])) <= 0)
+						usage(argv[0]);
+				break;
+			case 'c':
+				cfg->nslots = atoi(optarg);
+				break;
+			case 'n':
+				cfg->ntasks = atol(optarg);
+				break;
+			case 'l':
+				cfg->load = atof(optarg);
+				break;
+			case 'b':
+				cfg->burst_ms = atof(optarg);
+				break;
+			case 'k':
+				cfg->bursts = atoi(optarg);
+				break;
+			case 'w':
+				cfg->io_ms = atof(optarg);
+				break;
+			case 'd':
+				cfg->deadline_factor = atof(optarg);
+				break;
+			case 'x':
+				cfg->switch_us = atol(optarg);
+				break;
+			case 'S':
+				cfg->seed = strtoul(optarg, NULL, 0);
+				break;
+			case 'f':
+				cfg->workload = optarg;
+				break;
+			case 'o':
+				cfg->csv = optarg;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (optind != argc || cfg->nslots < 1 || cfg->nslots > SIM_MAX_LIST ||
+	    cfg->ntasks < 1 || cfg->load <= 0 || cfg->burst_ms <= 0 ||
+	    cfg->bursts < 1 || cfg->io_ms < 0 || cfg->deadline_factor < 0 ||
+	    cfg->switch_us < 0 || cfg->seed == 0)
+		usage(argv[0]);
+	if (cfg->npolicies == 0)
+		cfg->policies[cfg->npolicies++] = "rr";
+	if (cfg->nquanta == 0)
+		cfg->quanta[cfg->nquanta++] = 20;
+	for (p = 0; p < cfg->npolicies; p++) {
+		if (find_policy(cfg->policies[p]) == NULL) {
+			fprintf(stderr, "%s: unknown policy `%s'\n", argv[0], cfg->policies[p]);
+			usage(argv[0]);
+		}
+	}
+	if (cfg->workload != NULL && (workload_fp = fopen(cfg->workload, "r")) == NULL) {
+		perror(cfg->workload);
+		exit(1);
+	}
+	if (cfg->csv != NULL)
+		csv = open_csv(cfg->csv);
+
+	printf("%-8s %5s %8s %10s %10s %10s %10s %10s %8s %6s %6s %9s %8s\n",
+	       "policy", "q_ms", "tasks", "makespan_s", "turn_mean", "turn_p99",
+	       "resp_mean", "resp_p99", "slowdown", "jain", "util%", "switches",
+	       "wall_ms");
+	for (p = 0; p < cfg->npolicies; p++) {
+		for (q = 0; q < cfg->nquanta; q++) {
+			simulate(cfg->policies[p], cfg->quanta[q]);
+			printf("%-8s %5ld %8ld %10.3f %10.1f %10.1f %10.1f %10.1f %8.2f %6.3f %6.1f %9ld %8.0f\n",
+			       cfg->policies[p], cfg->quanta[q], res.tasks,
+			       res.makespan_s, res.turnaround_mean_ms,
+			       res.turnaround_p99_ms, res.response_mean_ms,
+			       res.response_p99_ms, res.slowdown, res.fairness,
+			       100 * res.utilization, res.dispatches, res.wall_ms);
+			if (res.rejected || res.missed)
+				printf("%-8s %5s %ld rejected, %ld missed their deadlines\n",
+				       "", "", res.rejected, res.missed);
+			if (csv != NULL) {
+				fprintf(csv, "%s,%ld,%d,%ld,%ld,%ld,%.6f,%.3f,%.3f,%.3f,"
+					"%.3f,%.4f,%.4f,%.4f,%ld,%.1f\n",
+					cfg->policies[p], cfg->quanta[q], cfg->nslots,
+					res.tasks, res.rejected, res.missed,
+					res.makespan_s, res.turnaround_mean_ms,
+					res.turnaround_p99_ms, res.response_mean_ms,
+					res.response_p99_ms, res.slowdown, res.fairness,
+					res.utilization, res.dispatches, res.wall_ms);
+				fflush(csv);
+			}
+		}
+	}
+	if (csv != NULL)
+		fclose(csv);
+	return 0;
+}
@@ -0,0 +1,270 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sched-stats.h"
+
+/*
+ * Per-task records of the last stats_exited_max tasks that have exited,
+ * for the dump: a ring, so that a scheduler that runs for days doesn't
+ * grow with every task it has reaped. Older tasks only count towards
+ * the totals.
+ */
+struct exited_task {
+	int id;
+	pid_t pid;
+	char name[TASK_NAME_SZ];
+	struct task_stats stats;
+};
+
+long stats_exited_max = STATS_EXITED_MAX;
+
+static struct exited_task *exited = NULL;
+static int exited_cap = 0;
+static long nexited = 0;
+
+/* Totals over every task that has exited */
+static struct task_stats exited_total;
+static long long exited_turnaround_ns = 0;
+
+static struct stats_hist latency_hist = { .name = "dispatch_latency" };
+static struct stats_hist wait_hist = { .name = "wait" };
+static struct stats_hist slice_hist = { .name = "slice" };
+static struct stats_hist spawn_hist = { .name = "spawn" };
+
+static long long start_ns = 0;
+static long dispatches = 0;
+static long long startup_ns = 0, first_dispatch_ns = 0;
+
+long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void hist_add(struct stats_hist *h, long long ns)
+{
+	long long us = ns / 1000;
+	int b = 0;
+
+	if (ns < 0)
+		return;
+	while (us > 1 && b < STATS_HIST_BUCKETS - 1) {
+		us >>= 1;
+		b++;
+	}
+	h->buckets[b]++;
+	h->count++;
+	h->sum_ns += ns;
+	if (ns > h->max_ns)
+		h->max_ns = ns;
+}
+
+/* Upper bound (us) of the bucket holding the p-th percentile */
+static long long hist_percentile(struct stats_hist *h, int p)
+{
+	long seen = 0, want = (h->count * p + 99) / 100;
+	int b;
+
+	for (b = 0; b < STATS_HIST_BUCKETS; b++) {
+		seen += h->buckets[b];
+		if (seen >= want && seen > 0)
+			return 2LL << b;
+	}
+	return 0;
+}
+
+void stats_task_created(node *t)
+{
+	if (start_ns == 0)
+		start_ns = now_ns();
+	memset(&t->stats, 0, sizeof(t->stats));
+	t->stats.created_ns = now_ns();
+	t->stats.since_ns = t->stats.created_ns;
+}
+
+void stats_dispatched(node *t, long long latency_ns)
+{
+	long long now = now_ns();
+
+	t->stats.wait_ns += now - t->stats.since_ns;
+	hist_add(&wait_hist, now - t->stats.since_ns);
+	hist_add(&latency_hist, latency_ns);
+	t->stats.since_ns = now;
+	t->stats.quanta++;
+	dispatches++;
+}
+
+void stats_preempted(node *t)
+{
+	long long now = now_ns();
+
+	t->stats.run_ns += now - t->stats.since_ns;
+	hist_add(&slice_hist, now - t->stats.since_ns);
+	t->stats.cpu_ns += t->slice_ns;
+	t->stats.since_ns = now;
+}
+
+void stats_task_exited(node *t, int was_running)
+{
+	long long now = now_ns();
+	struct exited_task *e;
+
+	if (was_running)
+		t->stats.run_ns += now - t->stats.since_ns;
+	else
+		t->stats.wait_ns += now - t->stats.since_ns;
+	t->stats.exited_ns = now;
+
+	exited_total.run_ns += t->stats.run_ns;
+	exited_total.wait_ns += t->stats.wait_ns;
+	exited_total.cpu_ns += t->stats.cpu_ns;
+	exited_total.quanta += t->stats.quanta;
+	exited_turnaround_ns += now - t->stats.created_ns;
+
+	/* Grow up to the limit, then overwrite the oldest */
+	if (nexited == exited_cap && exited_cap < stats_exited_max) {
+		exited_cap = exited_cap ? 2 * exited_cap : 64;
+		if (exited_cap > stats_exited_max)
+			exited_cap = stats_exited_max;
+		exited = realloc(exited, exited_cap * sizeof(*exited));
+		if (exited == NULL) {
+			perror("stats_task_exited: realloc");
+			exit(1);
+		}
+	}
+	e = &exited[nexited++ % exited_cap];
+	e->id = t->id;
+	e->pid = t->pid;
+	memcpy(e->name, t->name, TASK_NAME_SZ);
+	e->stats = t->stats;
+}
+
+static void hist_print(struct stats_hist *h)
+{
+	int b;
+
+	printf("%s (us): count %ld, mean %lld, p50 <%lld, p99 <%lld, max %lld\n",
+		h->name, h->count, h->count ? h->sum_ns / h->count / 1000 : 0,
+		hist_percentile(h, 50), hist_percentile(h, 99), h->max_ns / 1000);
+	for (b = 0; b < STATS_HIST_BUCKETS; b++)
+		if (h->buckets[b])
+			printf("  [%lld, %lld)\t%ld\n", b ? 1LL << b : 0, 2LL << b, h->buckets[b]);
+}
+
+void stats_spawned(long long spawn_ns)
+{
+	hist_add(&spawn_hist, spawn_ns);
+}
+
+void stats_started(long long ns)
+{
+	startup_ns = ns;
+}
+
+void stats_first_dispatch(long long ns)
+{
+	first_dispatch_ns = ns;
+}
+
+void stats_print(void)
+{
+	long long now = now_ns(), total_cpu = 0;
+	node *t = proc_list;
+
+	/* Each task's share of the CPU time the live tasks have had */
+	if (t != NULL) {
+		do {
+			total_cpu += t->stats.cpu_ns;
+			t = t->next;
+		} while (t != proc_list);
+	}
+
+	printf("id\tpid\tquanta\trun_ms\twait_ms\tcpu_ms\tshare%%\tname\n");
+	if (t != NULL) {
+		do {
+			printf("%d\t%d\t%ld\t%lld\t%lld\t%lld\t%.1f\t%s\n", t->id, t->pid,
+				t->stats.quanta, t->stats.run_ns / 1000000,
+				t->stats.wait_ns / 1000000, t->stats.cpu_ns / 1000000,
+				total_cpu ? 100.0 * t->stats.cpu_ns / total_cpu : 0.0, t->name);
+			t = t->next;
+		} while (t != proc_list);
+	}
+	printf("\n%ld dispatches in %lld ms, %ld tasks exited, "
+		"startup took %lld us, first dispatch after %lld us\n",
+		dispatches, (now - start_ns) / 1000000, nexited,
+		startup_ns / 1000, first_dispatch_ns / 1000);
+	if (nexited > 0)
+		printf("exited tasks: mean turnaround %lld ms, run %lld ms, wait %lld ms, "
+			"cpu %lld ms\n", exited_turnaround_ns / nexited / 1000000,
+			exited_total.run_ns / nexited / 1000000,
+			exited_total.wait_ns / nexited / 1000000,
+			exited_total.cpu_ns / nexited / 1000000);
+	hist_print(&latency_hist);
+	hist_print(&wait_hist);
+	hist_print(&slice_hist);
+	hist_print(&spawn_hist);
+	printf("\n");
+}
+
+static void dump_task(FILE *fp, const char *state, int id, pid_t pid,
+		      const char *name, struct task_stats *st)
+{
+	fprintf(fp, "task id=%d pid=%d state=%s quanta=%ld run_ns=%lld wait_ns=%lld "
+		"cpu_ns=%lld created_ns=%lld exited_ns=%lld name=%s\n",
+		id, pid, state, st->quanta, st->run_ns, st->wait_ns, st->cpu_ns,
+		st->created_ns - start_ns, st->exited_ns ? st->exited_ns - start_ns : 0,
+		name);
+}
+
+static void dump_hist(FILE *fp, struct stats_hist *h)
+{
+	int b;
+
+	fprintf(fp, "hist name=%s count=%ld sum_ns=%lld max_ns=%lld buckets_us=",
+		h->name, h->count, h->sum_ns, h->max_ns);
+	for (b = 0; b < STATS_HIST_BUCKETS; b++)
+		fprintf(fp, "%s%ld", b ? "," : "", h->buckets[b]);
+	fprintf(fp, "\n");
+}
+
+int stats_dump(const char *path)
+{
+	FILE *fp = fopen(path, "w");
+	node *t = proc_list;
+	struct exited_task *e;
+	long n;
+
+	if (fp == NULL)
+		return -errno;
+
+	fprintf(fp, "sched elapsed_ns=%lld dispatches=%ld exited=%ld startup_ns=%lld "
+		"first_dispatch_ns=%lld\n", now_ns() - start_ns, dispatches,
+		nexited, startup_ns, first_dispatch_ns);
+	fprintf(fp, "exited count=%ld quanta=%ld run_ns=%lld wait_ns=%lld cpu_ns=%lld "
+		"turnaround_ns=%lld\n", nexited, exited_total.quanta, exited_total.run_ns,
+		exited_total.wait_ns, exited_total.cpu_ns, exited_turnaround_ns);
+	/* Oldest first */
+	for (n = nexited > exited_cap ? nexited - exited_cap : 0; n < nexited; n++) {
+		e = &exited[n % exited_cap];
+		dump_task(fp, "exited", e->id, e->pid, e->name, &e->stats);
+	}
+	if (t != NULL) {
+		do {
+			dump_task(fp, "live", t->id, t->pid, t->name, &t->stats);
+			t = t->next;
+		} while (t != proc_list);
+	}
+	dump_hist(fp, &latency_hist);
+	dump_hist(fp, &wait_hist);
+	dump_hist(fp, &slice_hist);
+	dump_hist(fp, &spawn_hist);
+
+	if (fclose(fp) != 0)
+		return -errno;
+	return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef SCHED_STATS_H
+#define SCHED_STATS_H
+
+#include "task-list.h"
+
+/******************************************************************************
+ * Scheduler instrumentation.
+ *
+ * The core reports every task state change here; we keep per-task
+ * wait/run/CPU time and quanta, plus global histograms of dispatch
+ * latency (quantum timer expiry to SIGCONT sent), wait before each
+ * dispatch, slice length and the time taken to launch each task.
+ */
+
+#define STATS_HIST_BUCKETS 32         /* log2 buckets, in microseconds */
+#define STATS_EXITED_MAX 4096         /* exited tasks kept for the dump, by default */
+
+struct stats_hist {
+	const char *name;
+	long count;
+	long long sum_ns;
+	long long max_ns;
+	long buckets[STATS_HIST_BUCKETS];
+};
+
+/* Exited tasks kept for the dump (-S) */
+extern long stats_exited_max;
+
+/* CLOCK_MONOTONIC in ns */
+long long now_ns(void);
+
+/* A task has been created and is waiting for its first dispatch. */
+void stats_task_created(node *t);
+
+/*
+ * A task has been dispatched. latency_ns is the time since the quantum
+ * timer that ended the previous slice expired, -1 if the slot was idle
+ * or its task exited.
+ */
+void stats_dispatched(node *t, long long latency_ns);
+
+/* The running task's slice is over; t->slice_ns holds its CPU time. */
+void stats_preempted(node *t);
+
+/* A task has exited. */
+void stats_task_exited(node *t, int was_running);
+
+/* A task has been launched, taking spawn_ns. */
+void stats_spawned(long long spawn_ns);
+
+/* The initial tasks were all ready ns after the first was launched. */
+void stats_started(long long ns);
+
+/* The first task was dispatched ns after the first was launched. */
+void stats_first_dispatch(long long ns);
+
+/* Human-readable report, for the shell's s command. */
+void stats_print(void);
+
+/*
+ * Machine-readable dump of every live task, the last stats_exited_max
+ * tasks that exited, totals over all of those that exited, and the
+ * histograms, as key=value lines. Returns 0 or -errno.
+ */
+int stats_dump(const char *path);
+
+#endif /* SCHED_STATS_H */
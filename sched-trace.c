@@ -0,0 +1,98 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+
+#include "sched-trace.h"
+#include "sched-stats.h"
+
+struct trace_header *trace_hdr = NULL;
+static struct trace_record *trace_ring;
+static size_t trace_size;
+
+int trace_open(const char *path, long nrecords, const char *policy,
+	       int ncpus, int quantum_ms)
+{
+	int fd, err;
+	void *p;
+
+	if (nrecords < 1)
+		return -EINVAL;
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return -errno;
+	trace_size = sizeof(struct trace_header) + nrecords * sizeof(struct trace_record);
+	if (ftruncate(fd, trace_size) < 0) {
+		err = errno;
+		close(fd);
+		return -err;
+	}
+	p = mmap(NULL, trace_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	err = errno;
+	close(fd);
+	if (p == MAP_FAILED)
+		return -err;
+
+	trace_hdr = p;
+	trace_ring = (struct trace_record *)(trace_hdr + 1);
+	memcpy(trace_hdr->magic, TRACE_MAGIC, sizeof(trace_hdr->magic));
+	trace_hdr->version = TRACE_VERSION;
+	trace_hdr->record_size = sizeof(struct trace_record);
+	trace_hdr->nrecords = nrecords;
+	trace_hdr->head = 0;
+	trace_hdr->start_ns = now_ns();
+	trace_hdr->ncpus = ncpus;
+	trace_hdr->quantum_ms = quantum_ms;
+	strncpy(trace_hdr->policy, policy, sizeof(trace_hdr->policy) - 1);
+	return 0;
+}
+
+/* The next record, which head is advanced past once it is filled in */
+static struct trace_record *trace_next(int type, int cpu, int id, pid_t pid, int aux)
+{
+	struct trace_record *r = &trace_ring[trace_hdr->head % trace_hdr->nrecords];
+
+	r->ts_ns = now_ns();
+	r->type = type;
+	r->cpu = cpu;
+	r->id = id;
+	r->pid = pid;
+	r->aux = aux;
+	return r;
+}
+
+void trace_emit(int type, int cpu, int id, pid_t pid, int aux, long long arg)
+{
+	struct trace_record *r = trace_next(type, cpu, id, pid, aux);
+
+	r->arg = arg;
+	trace_hdr->head++;
+}
+
+void trace_create(int id, pid_t pid, const char *name)
+{
+	struct trace_record *r;
+	size_t len;
+
+	if (trace_hdr == NULL)
+		return;
+	r = trace_next(TRACE_CREATE, -1, id, pid, 0);
+	/* The end of a path tells tasks apart better than its start */
+	len = strlen(name);
+	if (len >= TRACE_NAME_SZ)
+		name += len - (TRACE_NAME_SZ - 1);
+	memset(r->name, 0, TRACE_NAME_SZ);
+	memcpy(r->name, name, strlen(name));
+	trace_hdr->head++;
+}
+
+void trace_close(void)
+{
+	if (trace_hdr == NULL)
+		return;
+	munmap(trace_hdr, trace_size);
+	trace_hdr = NULL;
+}
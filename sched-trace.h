@@ -0,0 +1,90 @@
+#ifndef SCHED_TRACE_H
+#define SCHED_TRACE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/******************************************************************************
+ * Binary event trace.
+ *
+ * With -t file, the core records every scheduling event in a ring of
+ * fixed-size records in file, which is mmap()ed shared: recording an
+ * event is a few stores to memory, with no system call and no
+ * formatting, and the kernel writes the pages back to the file, even if
+ * the scheduler crashes. Once the ring is full the oldest records are
+ * overwritten. sched-replay reads the file back and rebuilds what each
+ * task went through.
+ *
+ * The file is a trace_header followed by nrecords trace_records;
+ * record n (counting from 0, over the whole run) is at n % nrecords.
+ */
+
+#define TRACE_MAGIC "SCHEDTRC"
+#define TRACE_VERSION 1
+#define TRACE_RECORDS (64 * 1024)   /* default ring size */
+#define TRACE_NAME_SZ 16
+
+enum trace_event {
+	TRACE_CREATE,    /* task id/pid created, ->name; cpu -1 */
+	TRACE_READY,     /* task stopped and queued on cpu */
+	TRACE_DISPATCH,  /* task continued on cpu; ->arg: dispatch latency ns, -1 for none */
+	TRACE_PREEMPT,   /* task told to stop on cpu; ->aux: 1 if before its quantum was up */
+	TRACE_STOP,      /* task's slice on cpu is over; ->arg: its CPU time ns */
+	TRACE_EXIT,      /* task exited; ->aux: wait status, ->arg: total CPU time ns */
+	TRACE_STEAL,     /* task pulled to cpu from ->aux */
+	TRACE_REQUEST,   /* shell request ->aux, id: its task_arg, ->arg: its result; pid 0 */
+	TRACE_NR_EVENTS
+};
+
+struct trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t nrecords;       /* size of the ring */
+	uint64_t head;           /* records written so far */
+	int64_t start_ns;        /* CLOCK_MONOTONIC when the trace began */
+	int32_t ncpus;
+	int32_t quantum_ms;
+	char policy[16];
+};
+
+struct trace_record {
+	int64_t ts_ns;           /* CLOCK_MONOTONIC */
+	uint16_t type;           /* enum trace_event */
+	int16_t cpu;             /* slot, -1 for none */
+	int32_t id;
+	int32_t pid;
+	int32_t aux;
+	union {
+		int64_t arg;
+		char name[TRACE_NAME_SZ];  /* TRACE_CREATE: the end of the name */
+	};
+};
+
+/* The mapped trace, NULL when not tracing */
+extern struct trace_header *trace_hdr;
+
+/*
+ * Create (or truncate) path as a trace of nrecords records and map it.
+ * Returns 0 or -errno.
+ */
+int trace_open(const char *path, long nrecords, const char *policy,
+	       int ncpus, int quantum_ms);
+
+/* Append a record; use trace_event(), which costs a test when not tracing. */
+void trace_emit(int type, int cpu, int id, pid_t pid, int aux, long long arg);
+
+/* Record the creation of a task. */
+void trace_create(int id, pid_t pid, const char *name);
+
+static inline void trace_event(int type, int cpu, int id, pid_t pid, int aux,
+			       long long arg)
+{
+	if (trace_hdr != NULL)
+		trace_emit(type, cpu, id, pid, aux, arg);
+}
+
+/* Unmap the trace, leaving the file for sched-replay. */
+void trace_close(void);
+
+#endif /* SCHED_TRACE_H */
@@ -11,231 +11,68 @@
 
 #include "proc-common.h"
 #include "request.h"
+#include "request-chan.h"
+#include "sched-core.h"
+#include "sched-trace.h"
 
 /* Compile-time parameters. */
-#define SCHED_TQ_SEC 2                /* time quantum */
-#define TASK_NAME_SZ 60               /* maximum size for a task's name */
 #define SHELL_EXECUTABLE_NAME "shell" /* executable for shell */
 
-/* Define Linked List Structure & functions */
-typedef struct node {
-  int id;
-  pid_t pid;
-  char* name;
-  int priority; /* 0 for LOW, 1 for HIGH */
-  struct node* next;
-  struct node* prev;
-} node;
-
-// Define ProcList
-node* proc_list = NULL;
-node* proc_list_high = NULL;
-volatile int nproc = 0;
-
-node* newNode(int id, pid_t pid, char* name) {
-  node* Node = (node*) malloc(sizeof(node));
-  Node->id = id;
-  Node->pid = pid;
-  Node->priority = 0; // All processes are initiated with LOW priority.
-  // Copy name to the struct
-  Node->name = strdup(name);
-  return Node;
-}
-
-node* addNode(node* list, pid_t pid, char* name) {
-  node* head = list;
-  if (head == NULL) {
-    head = newNode(0, pid, name);
-    head->next = head;
-    head->prev = head;
-  } else {
-    while (list->next != head) {
-      list = list->next;
-    }
-    list->next = newNode(list->id + 1, pid, name);
-    list->next->next = head;
-    list->next->prev = list;
-    head->prev = list->next;
-  }
-  return head;
-}
-
-void printList(node* list) {
-  node* head = list;
-  char priority[5];
-  do {
-    if (list->priority) {
-      strcpy(priority, "HIGH");
-    } else {
-      strcpy(priority, "LOW");
-    }
-    printf("id: %d\tpid: %d\tname: %s\tpriority: %s\n", list->id, list->pid, list->name, priority);
-    list = list->next;
-  } while (list != head);
-  printf("\n");
-}
-
-void disconnectNode(node* Node) {
-  Node->prev->next = Node->next;
-  Node->next->prev = Node->prev;
-}
-
-node* deleteNode(node* list, pid_t pid, int id) {
-  // Search by pid
-  node* head = list;
-  if (id == -1) {
-    if (list->pid == pid) {
-      disconnectNode(list);
-      head = list->next;
-      free(list);
-      return head;
-    }
-    list = list->next;
-    while (list != head) {
-      if (list->pid == pid) {
-        disconnectNode(list);
-        free(list);
-        break;
-      }
-      list = list->next;
-    }
-  } else {
-    // Search by id
-    if (list->id == id) {
-      list->next->prev = head->prev;
-      head->prev->next = list->next;
-      head = list->next;
-      free(list);
-      return head;
-    }
-    list = list->next;
-    while (list != head) {
-      if (list->id == id) {
-        list->prev->next = list->next;
-        list->next->prev = list->prev;
-        free(list);
-        break;
-      }
-      list = list->next;
-    }
-  }
-  return head;
-}
-
-node* accessNode(node* list, pid_t pid, int id) {
-  node* head = list;
-  if (id == -1 && pid >= 0) {
-    do {
-      if (list->pid == pid) {
-        return list;
-      }
-      list = list->next;
-    } while (list != head);
-    printf("Error: The node with pid: %d, doesn't exist!\n", pid);
-  } else {
-    do {
-      if (list->id == id) {
-        return list;
-      }
-      list = list->next;
-    } while (list != head);
-    printf("Error: The node with id: %d, doesn't exist!\n", id);
-  }
-  return NULL;
-}
-
-node* getNextProcess(node* this, int terminated) {
-  // if priority == 0 and there are other processes with HIGH
-  if (!this->next->priority && proc_list_high != NULL) {
-    if (terminated && proc_list_high == this) return this->next;
-    else return proc_list_high;
-  }
-  return this->next;
-}
-
-static void sched_set_priority_high(int id) {
-  node* this = accessNode(proc_list, -1, id);
-  if (this != NULL) {
-    disconnectNode(this);
-    this->priority = 1;
-    node* list = proc_list;
-    // Search until u find the last zero
-    while ((list->prev != proc_list) && (list->prev->priority == 0)) {
-      list = list->prev;
-    }
-    this->prev = list->prev;
-    this->next = list;
-    list->prev->next = this;
-    list->prev = this;
-    if (proc_list_high == NULL) proc_list_high = this;
-  }
-}
-
-static void sched_set_priority_low(int id) {
-  node* this = accessNode(proc_list, -1, id);
-  if (this != NULL) {
-    this->priority = 0;
-
-    node* list = proc_list_high;
-    disconnectNode(this);
-    this->prev = list->prev;
-    this->next = list;
-    list->prev->next = this;
-    list->prev = this;
-
-    // If we demoted the proc_list_high index we need to change it
-    if (proc_list_high == this) {
-      if (proc_list_high->next->priority) {
-        proc_list_high = proc_list_high->next;
-      } else {
-        proc_list_high = NULL;
-      }
-    }
-  }
-}
-
-/* Print a list of all tasks currently being scheduled.  */
-static void sched_print_tasks(void) {
-	printList(proc_list);
-}
-
-/* Send SIGKILL to a task determined by the value of its
- * scheduler-specific id.
- */
-static int sched_kill_task_by_id(int id) {
-  node* stopped = accessNode(proc_list, -1, id);
-  if (stopped != NULL) {
-    kill(stopped->pid, SIGKILL);
-    return id;
-  }
-  return 0;
-}
-
-/* Create a new task.  */
-static void sched_create_task(char *executable) {
-	pid_t pid = fork();
-	if (pid < 0) {
-		// Error code
-		perror("fork");
-	} else if (pid == 0) {
-		// Child process code
-		free(proc_list);
-		char *newargv[] = { executable, NULL, NULL, NULL };
-		char *newenviron[] = { NULL };
-		raise(SIGSTOP);
-		execve(executable, newargv, newenviron);
-		// Unreachable point. Execve only returns on error.
-		perror("execve");
-		exit(1);
-	} else {
-		// Parent Code
-		proc_list = addNode(proc_list, pid, executable);
-		nproc++;  /* number of proccesses goes here */
+_Static_assert(REQ_FRAME_MAX <= CHAN_RING_SIZE, "a frame must fit in a ring");
+
+/* Unpack a REQ_EXEC_ARGV payload and spawn the task it describes. */
+static int exec_payload(char *buf, size_t len)
+{
+	struct exec_payload hdr;
+	char **strs, **dst;
+	size_t off = sizeof(hdr);
+	uint32_t k, n, slen;
+	int ret = -EINVAL;
+
+	if (len < sizeof(hdr))
+		return -EINVAL;
+	memcpy(&hdr, buf, sizeof(hdr));
+	/* Every string takes a length at least: one at a time, so nothing wraps */
+	if (hdr.argc < 1 || hdr.argc > len / sizeof(slen) ||
+	    hdr.envc > len / sizeof(slen) - hdr.argc)
+		return -EINVAL;
+	n = hdr.argc + hdr.envc;
+
+	/* argv[], NULL, envp[], NULL */
+	strs = calloc(n + 2, sizeof(*strs));
+	if (strs == NULL)
+		return -ENOMEM;
+	for (k = 0; k < n; k++) {
+		if (len - off < sizeof(slen))
+			goto out;
+		memcpy(&slen, buf + off, sizeof(slen));
+		off += sizeof(slen);
+		if (slen > len - off)
+			goto out;
+		dst = (k < hdr.argc) ? &strs[k] : &strs[k + 1];
+		*dst = strndup(buf + off, slen);
+		if (*dst == NULL) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		off += slen;
 	}
+	if (off == len && hdr.deadline_ms > 0)
+		ret = (sched_spawn_deadline(strs, strs + hdr.argc + 1, hdr.deadline_ms,
+					    hdr.runtime_ms) < 0) ? -errno : 0;
+	else if (off == len)
+		ret = (sched_spawn_task(strs, strs + hdr.argc + 1) < 0) ? -errno : 0;
+
+out:
+	for (k = 0; k < n + 2; k++)
+		free(strs[k]);
+	free(strs);
+	return ret;
 }
 
-/* Process requests by the shell.  */
-static int process_request(struct request_struct *rq) {
+static int do_request(struct request_struct *rq, char *payload) {
+	int tickets;
+
 	switch (rq->request_no) {
 		case REQ_PRINT_TASKS:
 			sched_print_tasks();
@@ -245,172 +82,55 @@ static int process_request(struct request_struct *rq) {
 			return sched_kill_task_by_id(rq->task_arg);
 
 		case REQ_EXEC_TASK:
-			sched_create_task(rq->exec_task_arg);
-			return 0;
+			return (sched_fork_task(rq->exec_task_arg) < 0) ? -errno : 0;
 
-    case REQ_HIGH_TASK:
-      sched_set_priority_high(rq->task_arg);
-      return 0;
+		case REQ_EXEC_ARGV:
+			return exec_payload(payload, rq->task_arg);
 
-    case REQ_LOW_TASK:
-      sched_set_priority_low(rq->task_arg);
-      return 0;
+		case REQ_HIGH_TASK:
+			return sched_set_priority(rq->task_arg, 1);
 
-		default:
-			return -ENOSYS;
-	}
-}
+		case REQ_LOW_TASK:
+			return sched_set_priority(rq->task_arg, 0);
 
-/*
- * SIGALRM handler
- */
-static void sigalrm_handler(int signum) {
-	kill(proc_list->pid, SIGSTOP);
-}
+		case REQ_SET_TICKETS:
+			memcpy(&tickets, rq->exec_task_arg, sizeof(tickets));
+			return sched_set_tickets(rq->task_arg, tickets);
 
-/*
- * SIGCHLD handler
- */
-static void sigchld_handler(int signum) {
-  // Create SIGSSET
-  sigset_t sigset;
-  sigemptyset(&sigset);
-  sigaddset(&sigset, SIGALRM);
-
-  // Disable SIGALRM
-	if (sigprocmask(SIG_BLOCK, &sigset, NULL) < 0) {
-		perror("signals_disable: sigprocmask");
-		exit(1);
-	}
-
-  int status;
-  for (;;) {
-    if (nproc <= 0) break; // If there are no child processes just exit.
-    pid_t pid = waitpid(-1, &status, WUNTRACED | WNOHANG);
-    if (pid < 0) {
-      perror("waitpid");
-      exit(1);
-    }
-    if (pid == 0) break;
-
-    if (WIFEXITED(status) || WIFSIGNALED(status)) {
-      /* A child has died */
-      /* Start the next process */
-      node* stopped = accessNode(proc_list, pid, -1);
-      if (stopped == proc_list) {
-        node* next = getNextProcess(stopped, 1);
-
-        // Change the proc_list_high pointer
-        if (!next->priority) {
-          proc_list_high = NULL;
-        } else {
-          proc_list_high = next;
-        }
-
-        if (kill(next->pid, SIGCONT) < 0) {
-          perror("kill");
-        }
-        proc_list = next;
-        alarm(SCHED_TQ_SEC);
-      }
-      /* Delete the killed process from the list */
-      proc_list = deleteNode(proc_list, pid, -1);
-      nproc--;
-    }
-    if (WIFSTOPPED(status)) {
-      /* A child has stopped due to SIGSTOP/SIGTSTP, etc... */
-      node* stopped = accessNode(proc_list, pid, -1);
-      // Check if the child is the one running now
-      if (stopped == proc_list) {
-        proc_list = getNextProcess(proc_list, 0);
-        if (kill(proc_list->pid, SIGCONT) < 0) {
-          perror("kill");
-        }
-        /* Reset Alarm */
-        alarm(SCHED_TQ_SEC);
-      }
-    }
-  }
-
-  // Enable SIGALRM
-  if (sigprocmask(SIG_UNBLOCK, &sigset, NULL) < 0) {
-		perror("signals_enable: sigprocmask");
-		exit(1);
-	}
-}
+		case REQ_SET_QUANTUM:
+			return sched_set_quantum(rq->task_arg);
 
-/* Disable delivery of SIGALRM and SIGCHLD. */
-static void signals_disable(void) {
-	sigset_t sigset;
-
-	sigemptyset(&sigset);
-	sigaddset(&sigset, SIGALRM);
-	sigaddset(&sigset, SIGCHLD);
-	if (sigprocmask(SIG_BLOCK, &sigset, NULL) < 0) {
-		perror("signals_disable: sigprocmask");
-		exit(1);
-	}
-}
+		case REQ_PRINT_STATS:
+			sched_print_stats();
+			return 0;
 
-/* Enable delivery of SIGALRM and SIGCHLD.  */
-static void signals_enable(void) {
-	sigset_t sigset;
+		case REQ_DUMP_STATS:
+			return sched_dump_stats(rq->exec_task_arg);
 
-	sigemptyset(&sigset);
-	sigaddset(&sigset, SIGALRM);
-	sigaddset(&sigset, SIGCHLD);
-	if (sigprocmask(SIG_UNBLOCK, &sigset, NULL) < 0) {
-		perror("signals_enable: sigprocmask");
-		exit(1);
+		default:
+			return -ENOSYS;
 	}
 }
 
-/* Install two signal handlers.
- * One for SIGCHLD, one for SIGALRM.
- * Make sure both signals are masked when one of them is running.
- */
-static void install_signal_handlers(void) {
-	sigset_t sigset;
-	struct sigaction sa;
-
-	sa.sa_handler = sigchld_handler;
-	sa.sa_flags = SA_RESTART;
-	sigemptyset(&sigset);
-	sigaddset(&sigset, SIGCHLD);
-	sigaddset(&sigset, SIGALRM);
-	sa.sa_mask = sigset;
-	if (sigaction(SIGCHLD, &sa, NULL) < 0) {
-		perror("sigaction: sigchld");
-		exit(1);
-	}
-
-	sa.sa_handler = sigalrm_handler;
-	if (sigaction(SIGALRM, &sa, NULL) < 0) {
-		perror("sigaction: sigalrm");
-		exit(1);
-	}
+/* Process requests by the shell.  */
+static int process_request(struct request_struct *rq, char *payload) {
+	int ret = do_request(rq, payload);
 
-	/*
-	 * Ignore SIGPIPE, so that write()s to pipes
-	 * with no reader do not result in us being killed,
-	 * and write() returns EPIPE instead.
-	 */
-	if (signal(SIGPIPE, SIG_IGN) < 0) {
-		perror("signal: sigpipe");
-		exit(1);
-	}
+	trace_event(TRACE_REQUEST, -1, rq->task_arg, 0, rq->request_no, ret);
+	return ret;
 }
 
-static void do_shell(char *executable, int wfd, int rfd) {
-	char arg1[10], arg2[10];
-	char *newargv[] = { executable, NULL, NULL, NULL };
+static void do_shell(char *executable, struct req_chan *ch) {
+	char args[5][16];
+	char *newargv[] = { executable, NULL, NULL, NULL, NULL, NULL, NULL };
 	char *newenviron[] = { NULL };
+	int i, n;
 
-	sprintf(arg1, "%05d", wfd);
-	sprintf(arg2, "%05d", rfd);
-	newargv[1] = arg1;
-	newargv[2] = arg2;
+	n = chan_args(ch, args);
+	for (i = 0; i < n; i++)
+		newargv[i + 1] = args[i];
 
+	sched_child_reset_signals();
 	raise(SIGSTOP);
 	execve(executable, newargv, newenviron);
 
@@ -422,17 +142,16 @@ static void do_shell(char *executable, int wfd, int rfd) {
 /* Create a new shell task.
  *
  * The shell gets special treatment:
- * two pipes are created for communication and passed
- * as command-line arguments to the executable.
+ * a control channel is created for communication
+ * and passed as command-line arguments to the executable:
+ * two pipes, or shared memory rings, two eventfds and a pipe
+ * that hangs up if we die.
  */
-static pid_t sched_create_shell(char *executable, int *request_fd, int *return_fd) {
+static pid_t sched_create_shell(char *executable, struct req_chan *ch, int shm) {
+	struct req_chan peer;
 	pid_t p;
-	int pfds_rq[2], pfds_ret[2];
 
-	if (pipe(pfds_rq) < 0 || pipe(pfds_ret) < 0) {
-		perror("pipe");
-		exit(1);
-	}
+	chan_create(ch, &peer, shm);
 
 	p = fork();
 	if (p < 0) {
@@ -442,98 +161,155 @@ static pid_t sched_create_shell(char *executable, int *request_fd, int *return_f
 
 	if (p == 0) {
 		/* Child */
-		close(pfds_rq[0]);
-		close(pfds_ret[1]);
-		do_shell(executable, pfds_rq[1], pfds_ret[0]);
+		if (!shm)
+			chan_close(ch);
+		do_shell(executable, &peer);
 		assert(0);
 	}
-	/* Parent */
-	close(pfds_rq[1]);
-	close(pfds_ret[0]);
-	*request_fd = pfds_rq[0];
-	*return_fd = pfds_ret[1];
+	/* Parent: the eventfds are shared, the pipe ends are not */
+	if (!shm)
+		chan_close(&peer);
+	else {
+		close(peer.memfd);
+		close(peer.hupfd);
+		close(peer.livefd);
+	}
   return p;
 }
 
-static void shell_request_loop(int request_fd, int return_fd) {
-	int ret;
+/* Control channel with the shell */
+static struct req_chan shell_chan;
+static int shell_shm = 0;
+static struct sched_source shell_src;
+
+/* -i pipe|shm: the shell's control channel */
+static int shell_opt(int opt, char *arg)
+{
+	if (opt != 'i')
+		return -1;
+	if (strcmp(arg, "shm") == 0)
+		shell_shm = 1;
+	else if (strcmp(arg, "pipe") == 0)
+		shell_shm = 0;
+	else
+		return -1;
+	return 0;
+}
+
+/* Read the payload that follows rq, if it has one. */
+static int read_payload(struct req_chan *ch, struct request_struct *rq, char *payload)
+{
+	if (rq->request_no != REQ_EXEC_ARGV)
+		return 0;
+	if (rq->task_arg < 0 || rq->task_arg > REQ_EXEC_PAYLOAD_MAX) {
+		fprintf(stderr, "Scheduler: bad payload size %d from shell\n",
+			rq->task_arg);
+		return -1;
+	}
+	if (chan_recv(ch, payload, rq->task_arg) < 0) {
+		perror("scheduler: read payload from shell");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Read one request, or one batch, process it and send back the results.
+ * A batch is processed in order and answered with all results at once.
+ */
+static int shell_request(struct req_chan *ch)
+{
+	static struct request_struct batch[REQ_BATCH_MAX];
+	static char payload[REQ_EXEC_PAYLOAD_MAX];
+	static int ret[REQ_BATCH_MAX];
 	struct request_struct rq;
+	int i, n = 1;
 
-	/*
-	 * Keep receiving requests from the shell.
-	 */
-	for (;;) {
-		if (read(request_fd, &rq, sizeof(rq)) != sizeof(rq)) {
-			perror("scheduler: read from shell");
-			fprintf(stderr, "Scheduler: giving up on shell request processing.\n");
-			break;
+	if (chan_recv(ch, &rq, sizeof(rq)) < 0) {
+		perror("scheduler: read from shell");
+		return -1;
+	}
+
+	if (rq.request_no == REQ_BATCH) {
+		n = rq.task_arg;
+		if (n < 1 || n > REQ_BATCH_MAX) {
+			fprintf(stderr, "Scheduler: bad batch size %d from shell\n", n);
+			return -1;
+		}
+		if (chan_recv(ch, batch, n * sizeof(batch[0])) < 0) {
+			perror("scheduler: read batch from shell");
+			return -1;
+		}
+		/* The payloads follow the requests, in order */
+		for (i = 0; i < n; i++) {
+			if (read_payload(ch, &batch[i], payload) < 0)
+				return -1;
+			ret[i] = (batch[i].request_no == REQ_BATCH) ? -EINVAL
+					: process_request(&batch[i], payload);
 		}
+	} else {
+		if (read_payload(ch, &rq, payload) < 0)
+			return -1;
+		ret[0] = process_request(&rq, payload);
+	}
+
+	if (chan_send(ch, ret, n * sizeof(ret[0])) < 0) {
+		perror("scheduler: write to shell");
+		return -1;
+	}
+	return 0;
+}
 
-		signals_disable();
-		ret = process_request(&rq);
-		signals_enable();
+/* The shell has written to the channel: serve everything it has sent. */
+static void shell_readable(struct sched_source *src)
+{
+	struct req_chan *ch = src->arg;
 
-		if (write(return_fd, &ret, sizeof(ret)) != sizeof(ret)) {
-			perror("scheduler: write to shell");
+	if (!chan_readable(ch))
+		return;
+	do {
+		if (shell_request(ch) < 0) {
 			fprintf(stderr, "Scheduler: giving up on shell request processing.\n");
-			break;
+			sched_unwatch(src);
+			chan_close(ch);
+			return;
 		}
-	}
+	} while (ch->shm && chan_readable(ch));
 }
 
 int main(int argc, char *argv[]) {
-	/* Two file descriptors for communication with the shell */
-	static int request_fd, return_fd;
+	int i;
 
-	/* Create the shell. */
-	pid_t shell_pid = sched_create_shell(SHELL_EXECUTABLE_NAME, &request_fd, &return_fd);
-  proc_list = addNode(proc_list, shell_pid, SHELL_EXECUTABLE_NAME);
-	nproc++;
+	sched_extra_opts = "i:";
+	sched_extra_usage = " [-i pipe|shm]";
+	sched_extra_opt = shell_opt;
+	i = sched_parse_args(argc, argv, &prio_policy);
 
-	/* TODO: add the shell to the scheduler's tasks */
+	/* Create the shell and add it to the scheduler's tasks. */
+	pid_t shell_pid = sched_create_shell(SHELL_EXECUTABLE_NAME, &shell_chan, shell_shm);
+	sched_add_task(shell_pid, SHELL_EXECUTABLE_NAME, 0);
 
 	/*
-	 * For each of argv[1] to argv[argc - 1],
-	 * create a new child process, add it to the process list.
+	 * Set up the event loop and serve shell requests from it. Every
+	 * task runs as soon as it is ready, without waiting for the rest.
 	 */
-	int i;
-	for (i = 0; i < argc - 1; i++) {
-		sched_create_task(argv[i+1]);
-  }
-
-	if (nproc == 0) {
-		fprintf(stderr, "Scheduler: No tasks. Exiting...\n");
-		exit(1);
-	}
+	sched_start();
+	shell_src.fd = shell_chan.rfd;
+	shell_src.handle = shell_readable;
+	shell_src.arg = &shell_chan;
+	sched_watch(&shell_src);
 
-	/* Wait for all children to raise SIGSTOP before exec()ing. */
-	wait_for_ready_children(nproc);
-
-	/* Install SIGALRM and SIGCHLD handlers. */
-	install_signal_handlers();
-	// Start the first process and set alarm
-	kill(proc_list->pid, SIGCONT);
-  alarm(SCHED_TQ_SEC);
-
-
-	shell_request_loop(request_fd, return_fd);
-  nproc--;
-	/* Now that the shell is gone, just loop forever
-	 * until we exit from inside a signal handler.
+	/*
+	 * For each of argv[i] to argv[argc - 1],
+	 * create a new child process, add it to the process list.
 	 */
-   if (nproc > 0) {
-     while (1) {
-       if (pause() == -1) {
-         if (nproc == 0) {
-           printf("No processes on the list. Exiting...\n");
-           exit(0);
-         }
-       }
-     }
-   } else {
-     exit(0);
-   }
+	for (; i < argc; i++) {
+		sched_fork_task(argv[i]);
+		sched_poll();
+	}
 
+	/* Loop until every task has exited. */
+	sched_run();
 
 	/* Unreachable */
 	fprintf(stderr, "Internal error: Reached unreachable point\n");
@@ -5,19 +5,32 @@
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 
 #include "proc-common.h"
 #include "request.h"
+#include "request-chan.h"
 
-#define SHELL_CMDLINE_SZ 100
+#define SHELL_CMDLINE_SZ 4096
 
-void issue_request(int wfd, int rfd, struct request_struct *rq)
+/* Size of the payload following a request, if any */
+static size_t payload_len(struct request_struct *rq)
 {
+	return (rq->request_no == REQ_EXEC_ARGV) ? rq->task_arg : 0;
+}
+
+void issue_request(struct req_chan *ch, struct request_struct *rq, char *payload)
+{
+	static char frame[REQ_FRAME_MAX];
 	int ret;
 
+	/* The request and its payload go out as one message */
+	memcpy(frame, rq, sizeof(*rq));
+	memcpy(frame + sizeof(*rq), payload, payload_len(rq));
+
 	/* Issue the request */
 	fprintf(stderr, "Shell: issuing request...\n");
-	if (write(wfd, rq, sizeof(*rq)) != sizeof(*rq)) {
+	if (chan_send(ch, frame, sizeof(*rq) + payload_len(rq)) < 0) {
 		perror("Shell: write request struct");
 		exit(1);
 	}
@@ -25,7 +38,7 @@ void issue_request(int wfd, int rfd, struct request_struct *rq)
 	/* Block until a reply has been received */
 	fprintf(stderr, "Shell: receiving request return value...\n");
 
-	if (read(rfd, &ret, sizeof(ret)) != sizeof(ret)) {
+	if (chan_recv(ch, &ret, sizeof(ret)) < 0) {
 		perror("Shell: read request return value");
 		exit(1);
 	}
@@ -36,6 +49,47 @@ void issue_request(int wfd, int rfd, struct request_struct *rq)
 	}
 }
 
+/*
+ * Issue n requests as one batch: a single write for the REQ_BATCH
+ * header, the requests and their payloads, plen bytes in all,
+ * a single read for all return values.
+ */
+void issue_batch(struct req_chan *ch, struct request_struct *rqs, int n,
+		 char *payloads, size_t plen)
+{
+	static char frame[REQ_FRAME_MAX];
+	static int ret[REQ_BATCH_MAX];
+	struct request_struct hdr;
+	size_t len;
+	int i;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.request_no = REQ_BATCH;
+	hdr.task_arg = n;
+	memcpy(frame, &hdr, sizeof(hdr));
+	memcpy(frame + sizeof(hdr), rqs, n * sizeof(*rqs));
+	len = (n + 1) * sizeof(hdr);
+	memcpy(frame + len, payloads, plen);
+	len += plen;
+
+	fprintf(stderr, "Shell: issuing batch of %d requests...\n", n);
+	if (chan_send(ch, frame, len) < 0) {
+		perror("Shell: write request batch");
+		exit(1);
+	}
+
+	fprintf(stderr, "Shell: receiving batch return values...\n");
+	if (chan_recv(ch, ret, n * sizeof(ret[0])) < 0) {
+		perror("Shell: read batch return values");
+		exit(1);
+	}
+
+	for (i = 0; i < n; i++)
+		if (ret[i] < 0)
+			fprintf(stderr, "Shell: request %d return value ret = %d (%s)\n",
+				i + 1, ret[i], strerror(-ret[i]));
+}
+
 /*
  * Read a command line from the stream pointed to by fp
  * [a standard C library stream, *not* a file descriptor],
@@ -58,103 +112,291 @@ void help(void)
 	       " q          : quit\n"
 	       " p          : print tasks\n"
 	       " k <id>     : kill task identified by id\n"
-	       " e <program>: execute program\n"
+	       " e [-d <ms> -r <ms>] [VAR=value...] <program> [args...]\n"
+	       "            : execute program with args and environment,\n"
+	       "              to be done within -d ms needing -r ms of CPU (edf)\n"
 	       " h <id>     : set task identified by id to high priority\n"
-	       " l <id>     : set task identified by id to low priority\n");
+	       " l <id>     : set task identified by id to low priority\n"
+	       " n <id> <n> : give task identified by id n tickets\n"
+	       " t <ms>     : set the time quantum to ms milliseconds\n"
+	       " s          : print scheduler statistics\n"
+	       " S <file>   : dump scheduler statistics to file\n"
+	       " b <file>   : issue the commands in file as batches\n");
+}
+
+/* Append a length-prefixed string to an exec payload, -1 if it doesn't fit */
+static int payload_put(char *payload, size_t *len, const char *str)
+{
+	uint32_t n = strlen(str);
+
+	if (*len + sizeof(n) + n > REQ_EXEC_PAYLOAD_MAX)
+		return -1;
+	memcpy(payload + *len, &n, sizeof(n));
+	memcpy(payload + *len + sizeof(n), str, n);
+	*len += sizeof(n) + n;
+	return 0;
 }
 
 /*
- * Parse a command line, construct and
- * issue the relevant request to the scheduler.
+ * Parse "e [-d deadline_ms -r runtime_ms] [VAR=value...] program [args...]".
  *
- * Parsing is very simple, a better way would be to
- * break up the command line in tokens.
+ * A bare program with a short enough path and no deadline is sent as a plain
+ * REQ_EXEC_TASK; anything else as REQ_EXEC_ARGV with its argv and
+ * environment in the payload. Words are separated by blanks, there
+ * is no quoting.
  */
-void process_cmdline(char *cmdline, int wfd, int rfd)
+static int parse_exec(char *args, struct request_struct *rq, char *payload)
 {
-	struct request_struct rq;
+	char *words[SHELL_CMDLINE_SZ / 2], *w;
+	struct exec_payload hdr = { 0, 0, 0, 0 };
+	size_t len = sizeof(hdr);
+	int nwords = 0, i;
 
-	if (strlen(cmdline) == 0 || strcmp(cmdline, "?") == 0){
-		help();
-		return;
+	for (w = strtok(args, " \t"); w != NULL; w = strtok(NULL, " \t"))
+		words[nwords++] = w;
+
+	/* -d deadline_ms and -r runtime_ms come first, for the edf policy */
+	while (nwords >= 2 && (!strcmp(words[0], "-d") || !strcmp(words[0], "-r"))) {
+		if (words[0][1] == 'd')
+			hdr.deadline_ms = atoi(words[1]);
+		else
+			hdr.runtime_ms = atoi(words[1]);
+		memmove(words, words + 2, (nwords - 2) * sizeof(*words));
+		nwords -= 2;
+	}
+	if (hdr.runtime_ms > 0 && hdr.deadline_ms == 0) {
+		fprintf(stderr, "Shell: a runtime (-r) needs a deadline (-d)\n");
+		return -1;
 	}
 
-	/* Quit */
-	if (strcmp(cmdline, "q") == 0 || strcmp(cmdline, "Q") == 0) {
-		fprintf(stderr, "Shell: Exiting. Goodbye.\n");
-		exit(0);
+	/* Leading VAR=value words are the environment, the rest is argv */
+	while (hdr.envc < nwords && strchr(words[hdr.envc], '=') != NULL)
+		hdr.envc++;
+	hdr.argc = nwords - hdr.envc;
+	if (hdr.argc == 0)
+		return -1;
+
+	if (nwords == 1 && hdr.deadline_ms == 0 && strlen(words[0]) < EXEC_TASK_NAME_SZ) {
+		rq->request_no = REQ_EXEC_TASK;
+		strcpy(rq->exec_task_arg, words[0]);
+		return 0;
 	}
 
+	memcpy(payload, &hdr, sizeof(hdr));
+	for (i = 0; i < hdr.argc; i++)
+		if (payload_put(payload, &len, words[hdr.envc + i]) < 0)
+			goto toolong;
+	for (i = 0; i < hdr.envc; i++)
+		if (payload_put(payload, &len, words[i]) < 0)
+			goto toolong;
+
+	rq->request_no = REQ_EXEC_ARGV;
+	rq->task_arg = len;
+	return 0;
+
+toolong:
+	fprintf(stderr, "Shell: exec arguments longer than %d bytes\n",
+		REQ_EXEC_PAYLOAD_MAX);
+	return -1;
+}
+
+/*
+ * Parse a command line into a request. Exec requests may also fill in
+ * a payload, of up to REQ_EXEC_PAYLOAD_MAX bytes.
+ * Returns 0 on success, -1 if the command line is malformed.
+ *
+ * Parsing is very simple, a better way would be to
+ * break up the command line in tokens.
+ */
+int parse_cmdline(char *cmdline, struct request_struct *rq, char *payload)
+{
+	char *end, *num;
+	long tickets;
+	int n;
+
+	memset(rq, 0, sizeof(*rq));
+
 	/* Print Tasks */
 	if (strcmp(cmdline, "p") == 0 || strcmp(cmdline, "P") == 0) {
-		rq.request_no = REQ_PRINT_TASKS;
-		issue_request(wfd, rfd, &rq);
-		return;
+		rq->request_no = REQ_PRINT_TASKS;
+		return 0;
+	}
+
+	/* Print Statistics */
+	if (strcmp(cmdline, "s") == 0) {
+		rq->request_no = REQ_PRINT_STATS;
+		return 0;
+	}
+
+	/* Dump Statistics */
+	if (cmdline[0] == 'S' && cmdline[1] == ' ') {
+		rq->request_no = REQ_DUMP_STATS;
+		strncpy(rq->exec_task_arg, &cmdline[2], EXEC_TASK_NAME_SZ);
+		rq->exec_task_arg[EXEC_TASK_NAME_SZ - 1] = '\0';
+		return 0;
 	}
 
 	/* Kill Task */
 	if ((cmdline[0] == 'k' || cmdline[0] == 'K') &&
 	    cmdline[1] == ' ') {
-		rq.request_no = REQ_KILL_TASK;
-		rq.task_arg = atoi(&cmdline[2]);
-		issue_request(wfd, rfd, &rq);
-		return;
+		rq->request_no = REQ_KILL_TASK;
+		rq->task_arg = atoi(&cmdline[2]);
+		return 0;
 	}
 
 	/* Exec Task */
-	if ((cmdline[0] == 'e' || cmdline[0] == 'E') && cmdline[1] == ' ') {
-		rq.request_no = REQ_EXEC_TASK;
-		strncpy(rq.exec_task_arg, &cmdline[2], EXEC_TASK_NAME_SZ);
-		rq.exec_task_arg[EXEC_TASK_NAME_SZ - 1] = '\0';
-		issue_request(wfd, rfd, &rq);
-		return;
-	}
+	if ((cmdline[0] == 'e' || cmdline[0] == 'E') && cmdline[1] == ' ')
+		return parse_exec(&cmdline[2], rq, payload);
 
 	/* High-prioritize task */
 	if ((cmdline[0] == 'h' || cmdline[0] == 'H') && cmdline[1] == ' ') {
-		rq.request_no = REQ_HIGH_TASK;
-		rq.task_arg = atoi(&cmdline[2]);
-		issue_request(wfd, rfd, &rq);
-		return;
+		rq->request_no = REQ_HIGH_TASK;
+		rq->task_arg = atoi(&cmdline[2]);
+		return 0;
 	}
 
 	/* Low-prioritize task */
 	if ((cmdline[0] == 'l' || cmdline[0] == 'L') && cmdline[1] == ' ') {
-		rq.request_no = REQ_LOW_TASK;
-		rq.task_arg = atoi(&cmdline[2]);
-		issue_request(wfd, rfd, &rq);
-		return;
+		rq->request_no = REQ_LOW_TASK;
+		rq->task_arg = atoi(&cmdline[2]);
+		return 0;
+	}
+
+	/* Set tickets */
+	if ((cmdline[0] == 'n' || cmdline[0] == 'N') && cmdline[1] == ' ') {
+		rq->request_no = REQ_SET_TICKETS;
+		rq->task_arg = strtol(&cmdline[2], &num, 10);
+		if (num == &cmdline[2])
+			return -1;
+		errno = 0;
+		tickets = strtol(num, &end, 10);
+		if (end == num || *end != '\0' || errno == ERANGE ||
+		    tickets < INT_MIN || tickets > INT_MAX)
+			return -1;
+		/* As an int, not as text for the scheduler to parse again */
+		n = tickets;
+		memcpy(rq->exec_task_arg, &n, sizeof(n));
+		return 0;
+	}
+
+	/* Set time quantum */
+	if ((cmdline[0] == 't' || cmdline[0] == 'T') && cmdline[1] == ' ') {
+		rq->request_no = REQ_SET_QUANTUM;
+		rq->task_arg = atoi(&cmdline[2]);
+		return 0;
 	}
 
 	/* Parse error, malformed command, whatever... */
-	printf("command `%s': Bad Command.\n", cmdline);
+	return -1;
+}
+
+/*
+ * Read commands from a file, one per line, and issue them in batches
+ * of up to REQ_BATCH_MAX: one round trip to the scheduler per batch.
+ */
+void process_batch_file(char *path, struct req_chan *ch)
+{
+	static struct request_struct rqs[REQ_BATCH_MAX];
+	static char payloads[REQ_FRAME_MAX], payload[REQ_EXEC_PAYLOAD_MAX];
+	struct request_struct rq;
+	char line[SHELL_CMDLINE_SZ];
+	int n = 0, lineno = 0;
+	size_t plen = 0, len;
+	FILE *fp;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		perror(path);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		lineno++;
+		line[strcspn(line, "\n")] = '\0';
+		if (line[0] == '\0' || line[0] == '#')
+			continue;
+		if (parse_cmdline(line, &rqs[n], payload) < 0) {
+			printf("%s:%d: command `%s': Bad Command.\n",
+			       path, lineno, line);
+			continue;
+		}
+
+		/* Send what we have first if this one doesn't fit in the frame */
+		len = payload_len(&rqs[n]);
+		if ((n + 2) * sizeof(rqs[0]) + plen + len > REQ_FRAME_MAX) {
+			rq = rqs[n];
+			issue_batch(ch, rqs, n, payloads, plen);
+			rqs[0] = rq;
+			n = plen = 0;
+		}
+		memcpy(payloads + plen, payload, len);
+		plen += len;
+		if (++n == REQ_BATCH_MAX) {
+			issue_batch(ch, rqs, n, payloads, plen);
+			n = plen = 0;
+		}
+	}
+	if (n > 0)
+		issue_batch(ch, rqs, n, payloads, plen);
+	fclose(fp);
+}
+
+/*
+ * Parse a command line, construct and
+ * issue the relevant request to the scheduler.
+ */
+void process_cmdline(char *cmdline, struct req_chan *ch)
+{
+	static char payload[REQ_EXEC_PAYLOAD_MAX];
+	struct request_struct rq;
+
+	if (strlen(cmdline) == 0 || strcmp(cmdline, "?") == 0){
+		help();
+		return;
+	}
+
+	/* Quit */
+	if (strcmp(cmdline, "q") == 0 || strcmp(cmdline, "Q") == 0) {
+		fprintf(stderr, "Shell: Exiting. Goodbye.\n");
+		exit(0);
+	}
+
+	/* Batch of commands from a file */
+	if ((cmdline[0] == 'b' || cmdline[0] == 'B') && cmdline[1] == ' ') {
+		process_batch_file(&cmdline[2], ch);
+		return;
+	}
+
+	if (parse_cmdline(cmdline, &rq, payload) < 0) {
+		printf("command `%s': Bad Command.\n", cmdline);
+		return;
+	}
+	issue_request(ch, &rq, payload);
 }
 
 int main(int argc, char *argv[])
 {
-	int rfd, wfd;
+	struct req_chan ch;
 	char cmdline[SHELL_CMDLINE_SZ];
 
 	/*
-	 * Communication with the scheduler happens over two UNIX pipes.
+	 * Communication with the scheduler happens over two UNIX pipes,
+	 * or over two rings in shared memory.
 	 *
-	 * The scheduler first creates the pipes, then execve()s the shell
-	 * program. It passes two file descriptors as command-line arguments:
+	 * The scheduler first creates the channel, then execve()s the shell
+	 * program. For pipes it passes two file descriptors as command-line
+	 * arguments:
 	 *
 	 * argument 1: wfd: the file descriptor to write request structures into.
 	 * argument 2: rfd: the file descriptor to read request return values from.
+	 *
+	 * For the rings the arguments are "shm", the memfd holding the rings,
+	 * the eventfd to wake the scheduler with, the one it wakes us with,
+	 * and a pipe that hangs up if the scheduler dies.
 	 */
 
-	if (argc != 3) {
-		fprintf(stderr, "Shell: must be called with exactly two arguments.\n");
-		exit(1);
-	}
-
-	wfd = atoi(argv[1]);
-	rfd = atoi(argv[2]);
-	if (!wfd || !rfd) {
-		fprintf(stderr, "Shell: descriptors must be non-zero: wfd = %d, rfd = %d\n",
-			wfd, rfd);
+	if (chan_open(&ch, argc - 1, &argv[1]) < 0) {
+		fprintf(stderr, "Shell: must be called with two non-zero descriptors, "
+			"or with shm <memfd> <wfd> <rfd> <hupfd>.\n");
 		exit(1);
 	}
 
@@ -167,7 +409,7 @@ int main(int argc, char *argv[])
 		printf("Shell> ");
 		fflush(stdout);
 		get_cmdline(stdin, cmdline, SHELL_CMDLINE_SZ);
-		process_cmdline(cmdline, wfd, rfd);
+		process_cmdline(cmdline, &ch);
 	}
 
 	/* Unreachable */
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "task-heap.h"
+
+#define HEAP_MIN_CAP 16
+
+static long long
+heap_key(struct task_heap *h, node *t)
+{
+	return *(long long *)((char *)t + h->key);
+}
+
+static void
+heap_set(struct task_heap *h, int i, node *t)
+{
+	h->v[i] = t;
+	t->rq_idx = i;
+}
+
+static void
+heap_up(struct task_heap *h, int i)
+{
+	node *t = h->v[i];
+	long long k = heap_key(h, t);
+
+	while (i > 0 && heap_key(h, h->v[(i - 1) / 2]) > k) {
+		heap_set(h, i, h->v[(i - 1) / 2]);
+		i = (i - 1) / 2;
+	}
+	heap_set(h, i, t);
+}
+
+static void
+heap_down(struct task_heap *h, int i)
+{
+	node *t = h->v[i];
+	long long k = heap_key(h, t);
+	int c;
+
+	while ((c = 2 * i + 1) < h->len) {
+		if (c + 1 < h->len && heap_key(h, h->v[c + 1]) < heap_key(h, h->v[c]))
+			c++;
+		if (heap_key(h, h->v[c]) >= k)
+			break;
+		heap_set(h, i, h->v[c]);
+		i = c;
+	}
+	heap_set(h, i, t);
+}
+
+void
+heap_init(struct task_heap *h, size_t key)
+{
+	h->v = NULL;
+	h->len = h->cap = 0;
+	h->key = key;
+}
+
+void
+heap_free(struct task_heap *h)
+{
+	free(h->v);
+	heap_init(h, h->key);
+}
+
+void
+heap_push(struct task_heap *h, node *t)
+{
+	if (h->len == h->cap) {
+		h->cap = h->cap ? 2 * h->cap : HEAP_MIN_CAP;
+		h->v = realloc(h->v, h->cap * sizeof(*h->v));
+		if (h->v == NULL) {
+			perror("heap_push: realloc");
+			exit(1);
+		}
+	}
+	heap_set(h, h->len++, t);
+	heap_up(h, t->rq_idx);
+}
+
+void
+heap_remove(struct task_heap *h, node *t)
+{
+	int i = t->rq_idx;
+
+	if (i == --h->len)
+		return;
+	/* The last task takes the hole, then goes whichever way it has to */
+	heap_set(h, i, h->v[h->len]);
+	heap_fix(h, h->v[i]);
+}
+
+void
+heap_fix(struct task_heap *h, node *t)
+{
+	heap_up(h, t->rq_idx);
+	heap_down(h, t->rq_idx);
+}
@@ -0,0 +1,44 @@
+#ifndef TASK_HEAP_H
+#define TASK_HEAP_H
+
+#include <stddef.h>
+
+#include "task-list.h"
+
+/******************************************************************************
+ * Binary min-heap of tasks, for policies that always run the task with
+ * the smallest key.
+ *
+ * The key is a long long field of the node, given by its offset, and
+ * each task's place in the heap is kept in its rq_idx, so the minimum
+ * is O(1) and insertion, removal and rekeying are O(log n).
+ */
+
+struct task_heap {
+	node **v;
+	int len, cap;
+	size_t key;      /* offsetof(node, <key field>) */
+};
+
+/* Initialize an empty heap ordered by the long long at key in each node. */
+void heap_init(struct task_heap *h, size_t key);
+
+/* Free the heap's array, leaving it empty. */
+void heap_free(struct task_heap *h);
+
+/* Add t. */
+void heap_push(struct task_heap *h, node *t);
+
+/* Remove t, which must be in the heap. */
+void heap_remove(struct task_heap *h, node *t);
+
+/* Restore the order after t's key has changed. */
+void heap_fix(struct task_heap *h, node *t);
+
+/* The task with the smallest key, NULL if the heap is empty. */
+static inline node *heap_min(struct task_heap *h)
+{
+	return h->len > 0 ? h->v[0] : NULL;
+}
+
+#endif /* TASK_HEAP_H */
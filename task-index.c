@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "task-index.h"
+
+#define INDEX_MIN_CAP 64
+
+static size_t
+index_slot(struct task_index *ix, int key)
+{
+	/*
+	 * Fibonacci hashing: the top bits of the product with 2^32 / phi,
+	 * which depend on every bit of the key, so consecutive pids and
+	 * ids spread well.
+	 */
+	return ((unsigned int)key * 2654435769u) >> (32 - ix->bits);
+}
+
+static void
+index_alloc(struct task_index *ix, size_t cap)
+{
+	size_t i;
+
+	ix->keys = malloc(cap * sizeof(*ix->keys));
+	ix->vals = malloc(cap * sizeof(*ix->vals));
+	if (ix->keys == NULL || ix->vals == NULL) {
+		perror("index_alloc: malloc");
+		exit(1);
+	}
+	for (i = 0; i < cap; i++)
+		ix->keys[i] = -1;
+	ix->cap = cap;
+	for (ix->bits = 0; ((size_t)1 << ix->bits) < cap; ix->bits++)
+		;
+	ix->len = 0;
+}
+
+void
+index_init(struct task_index *ix)
+{
+	index_alloc(ix, INDEX_MIN_CAP);
+}
+
+void *
+index_lookup(struct task_index *ix, int key)
+{
+	size_t i;
+
+	for (i = index_slot(ix, key); ix->keys[i] != -1; i = (i + 1) & (ix->cap - 1))
+		if (ix->keys[i] == key)
+			return ix->vals[i];
+	return NULL;
+}
+
+static void
+index_grow(struct task_index *ix)
+{
+	int *keys = ix->keys;
+	void **vals = ix->vals;
+	size_t i, cap = ix->cap;
+
+	index_alloc(ix, cap * 2);
+	for (i = 0; i < cap; i++)
+		if (keys[i] != -1)
+			index_insert(ix, keys[i], vals[i]);
+	free(keys);
+	free(vals);
+}
+
+void
+index_insert(struct task_index *ix, int key, void *val)
+{
+	size_t i;
+
+	if (2 * (ix->len + 1) > ix->cap)
+		index_grow(ix);
+
+	for (i = index_slot(ix, key); ix->keys[i] != -1; i = (i + 1) & (ix->cap - 1))
+		if (ix->keys[i] == key) {
+			ix->vals[i] = val;
+			return;
+		}
+	ix->keys[i] = key;
+	ix->vals[i] = val;
+	ix->len++;
+}
+
+void
+index_remove(struct task_index *ix, int key)
+{
+	size_t i, j, home;
+
+	for (i = index_slot(ix, key); ix->keys[i] != key; i = (i + 1) & (ix->cap - 1))
+		if (ix->keys[i] == -1)
+			return;
+
+	/*
+	 * Backward-shift deletion: move later entries of the probe
+	 * sequence into the hole, so no tombstones are needed.
+	 */
+	for (j = (i + 1) & (ix->cap - 1); ix->keys[j] != -1; j = (j + 1) & (ix->cap - 1)) {
+		home = index_slot(ix, ix->keys[j]);
+		if (((j - home) & (ix->cap - 1)) >= ((j - i) & (ix->cap - 1))) {
+			ix->keys[i] = ix->keys[j];
+			ix->vals[i] = ix->vals[j];
+			i = j;
+		}
+	}
+	ix->keys[i] = -1;
+	ix->len--;
+}
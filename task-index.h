@@ -0,0 +1,33 @@
+#ifndef TASK_INDEX_H
+#define TASK_INDEX_H
+
+#include <stddef.h>
+
+/******************************************************************************
+ * Hash index from a non-negative integer key (pid or task id) to a task.
+ *
+ * Open addressing with linear probing; the table doubles when it gets
+ * half full, so lookups, insertions and removals are O(1) on average.
+ */
+
+struct task_index {
+	int *keys;       /* -1 marks an empty slot */
+	void **vals;
+	size_t cap;      /* always a power of two */
+	int bits;        /* log2(cap) */
+	size_t len;
+};
+
+/* Initialize an empty index. */
+void index_init(struct task_index *ix);
+
+/* Return the value stored for key, or NULL if there is none. */
+void *index_lookup(struct task_index *ix, int key);
+
+/* Store val for key, replacing any previous value. */
+void index_insert(struct task_index *ix, int key, void *val);
+
+/* Remove key from the index, if present. */
+void index_remove(struct task_index *ix, int key);
+
+#endif /* TASK_INDEX_H */
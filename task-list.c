@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "task-list.h"
+#include "task-index.h"
+
+node* proc_list = NULL;
+
+/* pid -> node and id -> node, so lookups do not walk the list */
+static struct task_index pid_index, id_index;
+static int index_ready = 0;
+
+/* Next task id. Ids only grow, even when the last task exits. */
+static int next_id = 0;
+
+/* The node pool: free nodes are linked through ->next */
+static node* free_nodes = NULL;
+
+/* Add a slab of nodes to the pool */
+static void growPool(void) {
+  node* slab = (node*) malloc(TASK_SLAB_NODES * sizeof(node));
+  int i;
+  if (slab == NULL) {
+    perror("growPool: malloc");
+    exit(1);
+  }
+  for (i = TASK_SLAB_NODES - 1; i >= 0; i--) {
+    slab[i].next = free_nodes;
+    free_nodes = &slab[i];
+  }
+}
+
+static node* newNode(int id, pid_t pid, char* name) {
+  size_t len = strlen(name);
+  node* Node;
+
+  if (free_nodes == NULL) {
+    growPool();
+  }
+  Node = free_nodes;
+  free_nodes = Node->next;
+  memset(Node, 0, sizeof(*Node));
+  Node->id = id;
+  Node->pid = pid;
+  // Copy name to the struct, the end of it if it is too long
+  if (len < TASK_NAME_SZ) {
+    memcpy(Node->name, name, len + 1);
+  } else {
+    memcpy(Node->name, "...", 3);
+    memcpy(Node->name + 3, name + len - (TASK_NAME_SZ - 4), TASK_NAME_SZ - 3);
+  }
+  return Node;
+}
+
+/* Adds a node at the tail of the list (head->prev) in O(1) */
+node* addNode(pid_t pid, char* name) {
+  node* head = proc_list;
+  node* Node = newNode(next_id++, pid, name);
+
+  if (!index_ready) {
+    index_init(&pid_index);
+    index_init(&id_index);
+    index_ready = 1;
+  }
+
+  if (head == NULL) {
+    Node->next = Node;
+    Node->prev = Node;
+    proc_list = Node;
+  } else {
+    Node->next = head;
+    Node->prev = head->prev;
+    head->prev->next = Node;
+    head->prev = Node;
+  }
+  index_insert(&pid_index, Node->pid, Node);
+  index_insert(&id_index, Node->id, Node);
+  return Node;
+}
+
+void deleteNode(node* Node) {
+  index_remove(&pid_index, Node->pid);
+  index_remove(&id_index, Node->id);
+  if (Node->next == Node) {
+    proc_list = NULL;
+  } else {
+    Node->prev->next = Node->next;
+    Node->next->prev = Node->prev;
+    if (proc_list == Node) {
+      proc_list = Node->next;
+    }
+  }
+  Node->next = free_nodes;
+  free_nodes = Node;
+}
+
+node* accessNode(pid_t pid, int id) {
+  node* Node = NULL;
+  if (!index_ready) {
+    return NULL;
+  }
+  if (id == -1 && pid >= 0) {
+    Node = index_lookup(&pid_index, pid);
+    if (Node == NULL) {
+      printf("Error: The node with pid: %d, doesn't exist!\n", pid);
+    }
+  } else {
+    Node = index_lookup(&id_index, id);
+    if (Node == NULL) {
+      printf("Error: The node with id: %d, doesn't exist!\n", id);
+    }
+  }
+  return Node;
+}
+
+void rqAppend(node** queue, node* Node) {
+  node* head = *queue;
+  if (head == NULL) {
+    Node->rq_next = Node;
+    Node->rq_prev = Node;
+    *queue = Node;
+  } else {
+    Node->rq_next = head;
+    Node->rq_prev = head->rq_prev;
+    head->rq_prev->rq_next = Node;
+    head->rq_prev = Node;
+  }
+}
+
+void rqRemove(node** queue, node* Node) {
+  if (Node->rq_next == Node) {
+    *queue = NULL;
+  } else {
+    Node->rq_prev->rq_next = Node->rq_next;
+    Node->rq_next->rq_prev = Node->rq_prev;
+    if (*queue == Node) {
+      *queue = Node->rq_next;
+    }
+  }
+  Node->rq_next = NULL;
+  Node->rq_prev = NULL;
+}
+
+node* rqTail(node* queue, node* running) {
+  node* tail;
+  if (queue == NULL) {
+    return NULL;
+  }
+  tail = queue->rq_prev;
+  if (tail == running) {
+    tail = tail->rq_prev;
+  }
+  return tail == running ? NULL : tail;
+}
@@ -0,0 +1,106 @@
+#ifndef TASK_LIST_H
+#define TASK_LIST_H
+
+#include <sys/types.h>
+
+#include "rbtree.h"
+
+/******************************************************************************
+ * The scheduler's tasks.
+ *
+ * Every task is on one circular, doubly linked list (next/prev) and in
+ * the pid and id indexes. Its place in the run queue(s) is up to the
+ * scheduling policy, which owns the rq_* links and the policy fields.
+ *
+ * Nodes come from a pool of slabs of TASK_SLAB_NODES nodes each, with
+ * the name stored inline, and go back to it on deleteNode(). Slabs are
+ * only added when every node is in use and are never freed, so once the
+ * pool has grown to the peak number of tasks, creating and deleting
+ * tasks does no heap allocation. A node's address is stable for as long
+ * as it is in use.
+ */
+
+#define TASK_NAME_SZ 64         /* longer names keep their end */
+#define TASK_SLAB_NODES 256
+
+/* An event loop source: handle() is called when fd becomes readable */
+struct sched_source {
+  int fd;
+  void (*handle)(struct sched_source *src);
+  void *arg;
+};
+
+/* Per-task instrumentation, maintained by sched-stats.c */
+struct task_stats {
+  long long since_ns;   /* last dispatch, or since when it has been waiting */
+  long long run_ns;     /* wall time spent dispatched */
+  long long wait_ns;    /* wall time spent runnable but not dispatched */
+  long long cpu_ns;     /* CPU time used in completed slices */
+  long long created_ns;
+  long long exited_ns;
+  long quanta;          /* times dispatched */
+};
+
+typedef struct node {
+  int id;
+  pid_t pid;
+  char name[TASK_NAME_SZ];
+  struct node* next;
+  struct node* prev;
+
+  /* pidfd of the process; readable once it has exited */
+  struct sched_source pidfd;
+
+  /* cgroup of the task with the freezer or bandwidth backend, -1 when unused */
+  int cg_dir;           /* directory */
+  int cg_freeze;        /* its cgroup.freeze */
+  int cg_weight;        /* bandwidth: its cpu.weight */
+
+  /* Run queue links, owned by the scheduling policy */
+  struct node* rq_next;
+  struct node* rq_prev;
+
+  /* Run queue (CPU slot) the task is on, maintained by the scheduler core */
+  int cpu;
+  int prio_pending;     /* h/l asked for before it was on a run queue: 1 + high, 0 for none */
+
+  /* CPU accounting, maintained by the scheduler core */
+  long long cpu_mark;   /* CPU clock when last dispatched (ns) */
+  long long slice_ns;   /* CPU time used in the last slice */
+  struct task_stats stats;
+
+  /* Policy state */
+  int priority;         /* prio: 0 for LOW, 1 for HIGH */
+  int level;            /* mlfq: run queue, 0 is the highest */
+  long long used_ns;    /* mlfq: CPU time consumed at this level */
+  int tickets;          /* lottery, stride: share of the CPU */
+  long long pass;       /* stride: virtual time of its next slice */
+  struct rb_node rb;    /* cfs: place in the run queue's vruntime tree */
+  long long vruntime;   /* cfs: weighted CPU time (ns) */
+  int weight;           /* cfs: load weight, 0 until first enqueued */
+  long long deadline_ns;  /* edf: when it is to be done (CLOCK_MONOTONIC), 0 for never */
+  long long runtime_ns;   /* edf: CPU time it was admitted with */
+  long long ran_ns;       /* edf: CPU time used in completed slices */
+  int rq_idx;             /* place in the run queue's array, if the policy keeps one */
+} node;
+
+/* All tasks, in creation order */
+extern node* proc_list;
+
+/* Take a node from the pool with the next task id and add it to the list and indexes */
+node* addNode(pid_t pid, char* name);
+
+/* Remove a node from the list and indexes, and return it to the pool */
+void deleteNode(node* Node);
+
+/* Look a task up by pid (id == -1) or by id. NULL if there is none. */
+node* accessNode(pid_t pid, int id);
+
+/* Append to / remove from a circular run queue linked through rq_next/rq_prev */
+void rqAppend(node** queue, node* Node);
+void rqRemove(node** queue, node* Node);
+
+/* The last task of a run queue other than running, NULL if there is none */
+node* rqTail(node* queue, node* running);
+
+#endif /* TASK_LIST_H */
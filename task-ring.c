@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "task-ring.h"
+
+#define RING_MIN_CAP 16
+
+void
+ring_init(struct task_ring *r)
+{
+	r->v = NULL;
+	r->head = r->tail = 0;
+	r->cap = 0;
+	r->len = 0;
+}
+
+void
+ring_free(struct task_ring *r)
+{
+	free(r->v);
+	ring_init(r);
+}
+
+/* Squeeze the holes out, moving the tasks towards the head */
+static void
+ring_compact(struct task_ring *r)
+{
+	unsigned mask = r->cap - 1, p, w = r->head;
+	node *t;
+
+	for (p = r->head; p != r->tail; p++) {
+		t = r->v[p & mask];
+		if (t == NULL)
+			continue;
+		r->v[w & mask] = t;
+		t->rq_idx = w++;
+	}
+	for (p = w; p != r->tail; p++)
+		r->v[p & mask] = NULL;
+	r->tail = w;
+}
+
+/* Move the tasks to an array twice the size, starting at slot 0 */
+static void
+ring_grow(struct task_ring *r)
+{
+	unsigned cap = r->cap ? 2 * r->cap : RING_MIN_CAP, p, w = 0;
+	node **v = calloc(cap, sizeof(*v));
+	node *t;
+
+	if (v == NULL) {
+		perror("ring_grow: calloc");
+		exit(1);
+	}
+	for (p = r->head; p != r->tail; p++) {
+		t = r->v[p & (r->cap - 1)];
+		if (t == NULL)
+			continue;
+		v[w] = t;
+		t->rq_idx = w++;
+	}
+	free(r->v);
+	r->v = v;
+	r->cap = cap;
+	r->head = 0;
+	r->tail = w;
+}
+
+void
+ring_push(struct task_ring *r, node *t)
+{
+	if (r->tail - r->head == r->cap) {
+		if ((unsigned)r->len > r->cap / 2 || r->cap == 0)
+			ring_grow(r);
+		else
+			ring_compact(r);
+	}
+	r->v[r->tail & (r->cap - 1)] = t;
+	t->rq_idx = r->tail++;
+	r->len++;
+}
+
+void
+ring_remove(struct task_ring *r, node *t)
+{
+	unsigned mask = r->cap - 1;
+
+	r->v[(unsigned)t->rq_idx & mask] = NULL;
+	r->len--;
+	/* Keep a task at either end, so that head and tail are O(1) */
+	if (r->len == 0) {
+		r->head = r->tail;
+		return;
+	}
+	while (r->v[r->head & mask] == NULL)
+		r->head++;
+	while (r->v[(r->tail - 1) & mask] == NULL)
+		r->tail--;
+}
+
+void
+ring_requeue(struct task_ring *r, node *t)
+{
+	ring_remove(r, t);
+	ring_push(r, t);
+}
+
+node *
+ring_tail(struct task_ring *r, node *running)
+{
+	unsigned mask = r->cap - 1, p;
+	node *t;
+
+	for (p = r->tail; p != r->head; p--) {
+		t = r->v[(p - 1) & mask];
+		if (t != NULL && t != running)
+			return t;
+	}
+	return NULL;
+}
@@ -0,0 +1,51 @@
+#ifndef TASK_RING_H
+#define TASK_RING_H
+
+#include "task-list.h"
+
+/******************************************************************************
+ * FIFO run queue of tasks in a ring buffer, for the round-robin style
+ * policies.
+ *
+ * The tasks are kept in one array, in order, rather than linked through
+ * their nodes: sending the head to the back, the common case, reads and
+ * writes the array and the task's own rq_idx, and never the nodes of
+ * its neighbours. A task's position is kept in its rq_idx. Removing a
+ * task from the middle leaves a hole, which the head and tail skip and
+ * which is squeezed out in place once the array is full; the array only
+ * grows when the tasks themselves fill half of it.
+ */
+
+struct task_ring {
+	node **v;           /* cap slots, NULL for a hole */
+	unsigned head;      /* position of the first task; slot is pos & (cap - 1) */
+	unsigned tail;      /* position after the last task */
+	unsigned cap;       /* a power of two, 0 until the first push */
+	int len;            /* tasks in the ring */
+};
+
+/* Initialize an empty ring. */
+void ring_init(struct task_ring *r);
+
+/* Free the ring's array, leaving it empty. */
+void ring_free(struct task_ring *r);
+
+/* Append t at the back. */
+void ring_push(struct task_ring *r, node *t);
+
+/* Remove t, which must be in the ring. */
+void ring_remove(struct task_ring *r, node *t);
+
+/* Send t, which must be in the ring, to the back. */
+void ring_requeue(struct task_ring *r, node *t);
+
+/* The first task, NULL if the ring is empty. */
+static inline node *ring_head(struct task_ring *r)
+{
+	return r->len > 0 ? r->v[r->head & (r->cap - 1)] : NULL;
+}
+
+/* The last task other than running, NULL if there is none. */
+node *ring_tail(struct task_ring *r, node *running);
+
+#endif /* TASK_RING_H */
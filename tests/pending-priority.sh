@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# h/l on a task that is still starting: the request used to index the
+# run queue of slot -1. With -l fork, a task launched from a batch is
+# still starting when the next request in the batch comes in; the
+# priority has to be kept and applied once the task is enqueued.
+# Under lottery, where l means fewer tickets than the default, so the
+# shell still gets to run and the result shows.
+#
+# Run from the top directory, after make: tests/pending-priority.sh
+#
+
+tmp=$(mktemp -d /tmp/sched-test.XXXXXX) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+ln -s "$(pwd)/bench-task" "$tmp/cpu-1000"
+printf 'e %s/cpu-1000\nh 1\nl 1\np\n' "$tmp" > "$tmp/batch"
+
+# The second p comes once the task has been enqueued
+(sleep 0.3; echo "b $tmp/batch"; sleep 0.1; echo p; sleep 0.1; echo q) |
+	timeout 20 ./scheduler-shell -p lottery -l fork -q 100 > "$tmp/out" 2>&1
+rc=$?
+
+if [ $rc -ne 0 ]; then
+	echo "FAIL: scheduler-shell exited with $rc"
+	exit 1
+fi
+if ! grep -q "^id: 1	.*tickets: 25$" "$tmp/out"; then
+	echo "FAIL: task 1 didn't get the low priority asked for while starting"
+	cat "$tmp/out"
+	exit 1
+fi
+echo "PASS: pending-priority"